@@ -0,0 +1,239 @@
+# Compiles the hardware database schema into er/hwinfo/hwdb_schema.hpp, the
+# constraints enforced by er::hwinfo::impl::compiled_validator.
+#
+# The compiled validator knows the shape of hwdb-schema.json (types, keyed
+# revisions with an optional base and removed pins, pins) and takes its
+# limits from the generated header. Schema keywords it does not implement
+# are rejected here, so that the schema and the compiled validator cannot
+# silently drift apart.
+#
+# Usable from a project:
+#   er_hwinfo_compile_schema(<schema> <output>)
+# or standalone:
+#   cmake -DSCHEMA=<schema> -DOUTPUT=<output> -P er-hwinfo-schema.cmake
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  cmake_minimum_required(VERSION 3.22)
+endif()
+
+set(_ER_HWINFO_SCHEMA_TEMPLATE
+    ${CMAKE_CURRENT_LIST_DIR}/hwdb_schema.hpp.in)
+set(_ER_HWINFO_REVISION_PATTERN "^[0-9]+\\.[0-9]+\\.[0-9]+$")
+
+# Fails unless the schema node at PATH is an object using KEYWORDS only and,
+# if given, declares "type": TYPE
+function(_er_hwinfo_schema_node json)
+  cmake_parse_arguments(arg "" "TYPE" "PATH;KEYWORDS" ${ARGN})
+  string(REPLACE ";" "/" where "#/${arg_PATH}")
+  string(JSON kind ERROR_VARIABLE err TYPE "${json}" ${arg_PATH})
+  if(err OR NOT kind STREQUAL "OBJECT")
+    message(FATAL_ERROR "hwdb schema: ${where} must be an object")
+  endif()
+  string(JSON count LENGTH "${json}" ${arg_PATH})
+  if(count GREATER 0)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+      string(JSON keyword MEMBER "${json}" ${arg_PATH} ${i})
+      if(NOT keyword IN_LIST arg_KEYWORDS)
+        message(FATAL_ERROR
+            "hwdb schema: ${where} uses \"${keyword}\", which the compiled "
+            "validator does not implement")
+      endif()
+    endforeach()
+  endif()
+  if(arg_TYPE)
+    string(JSON type ERROR_VARIABLE err GET "${json}" ${arg_PATH} type)
+    if(err OR NOT type STREQUAL arg_TYPE)
+      message(FATAL_ERROR
+          "hwdb schema: ${where} must declare \"type\": \"${arg_TYPE}\"")
+    endif()
+  endif()
+endfunction()
+
+# Sets out to the integer at PATH, or to default if absent
+function(_er_hwinfo_schema_integer out json default)
+  string(JSON value ERROR_VARIABLE err GET "${json}" ${ARGN})
+  if(err)
+    set(value "${default}")
+  elseif(NOT value MATCHES "^-?[0-9]+$")
+    string(REPLACE ";" "/" where "#/${ARGN}")
+    message(FATAL_ERROR "hwdb schema: ${where} must be an integer")
+  endif()
+  set(${out} "${value}" PARENT_SCOPE)
+endfunction()
+
+# Sets out to "true" if the node at PATH declares the revision key pattern,
+# to "false" if it declares no pattern; other patterns are not implemented
+function(_er_hwinfo_schema_pattern out json)
+  string(JSON pattern ERROR_VARIABLE err GET "${json}" ${ARGN} pattern)
+  if(err)
+    set(${out} "false" PARENT_SCOPE)
+  elseif(pattern STREQUAL _ER_HWINFO_REVISION_PATTERN)
+    set(${out} "true" PARENT_SCOPE)
+  else()
+    string(REPLACE ";" "/" where "#/${ARGN}")
+    message(FATAL_ERROR
+        "hwdb schema: ${where} must use the pattern "
+        "\"${_ER_HWINFO_REVISION_PATTERN}\", the only one implemented")
+  endif()
+endfunction()
+
+# Sets out to "false" if additionalProperties at PATH is false, to "true" if
+# it is absent; any other value is not implemented
+function(_er_hwinfo_schema_additional out json)
+  string(JSON value ERROR_VARIABLE err GET "${json}" ${ARGN}
+         additionalProperties)
+  if(err)
+    set(${out} "true" PARENT_SCOPE)
+  elseif(value STREQUAL "OFF")
+    set(${out} "false" PARENT_SCOPE)
+  else()
+    string(REPLACE ";" "/" where "#/${ARGN}")
+    message(FATAL_ERROR
+        "hwdb schema: ${where}/additionalProperties must be false or absent")
+  endif()
+endfunction()
+
+# Sets <prefix>_<key>_required to "true" or "false" for each of KEYS, from
+# the required list at PATH
+function(_er_hwinfo_schema_required prefix json)
+  cmake_parse_arguments(arg "" "" "PATH;KEYS" ${ARGN})
+  set(required)
+  string(JSON count ERROR_VARIABLE err LENGTH "${json}" ${arg_PATH} required)
+  if(NOT err AND count GREATER 0)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+      string(JSON key GET "${json}" ${arg_PATH} required ${i})
+      if(NOT key IN_LIST arg_KEYS)
+        string(REPLACE ";" "/" where "#/${arg_PATH}")
+        message(FATAL_ERROR
+            "hwdb schema: ${where} requires unknown property \"${key}\"")
+      endif()
+      list(APPEND required "${key}")
+    endforeach()
+  endif()
+  foreach(key IN LISTS arg_KEYS)
+    if(key IN_LIST required)
+      set(${prefix}_${key}_required "true" PARENT_SCOPE)
+    else()
+      set(${prefix}_${key}_required "false" PARENT_SCOPE)
+    endif()
+  endforeach()
+endfunction()
+
+function(er_hwinfo_compile_schema schema output)
+  file(READ "${schema}" json)
+  if(NOT CMAKE_SCRIPT_MODE_FILE)
+    set_property(DIRECTORY APPEND PROPERTY CMAKE_CONFIGURE_DEPENDS "${schema}")
+  endif()
+
+  set(annotations "$schema" "$id" title description)
+  set(unlimited "std::numeric_limits<std::size_t>::max()")
+  set(types)
+  set(revisions additionalProperties)
+  set(revision ${revisions} additionalProperties)
+  set(pins ${revision} properties pins)
+  set(pin ${pins} additionalProperties)
+
+  _er_hwinfo_schema_node("${json}" TYPE object
+      KEYWORDS ${annotations} type propertyNames additionalProperties)
+  _er_hwinfo_schema_node("${json}" TYPE object PATH ${revisions}
+      KEYWORDS ${annotations} type propertyNames additionalProperties)
+  _er_hwinfo_schema_node("${json}" TYPE object PATH ${revision}
+      KEYWORDS ${annotations} type properties required additionalProperties)
+  _er_hwinfo_schema_node("${json}" PATH ${revision} properties
+      KEYWORDS pins base remove)
+  _er_hwinfo_schema_node("${json}" TYPE object PATH ${pins}
+      KEYWORDS ${annotations} type propertyNames additionalProperties)
+  _er_hwinfo_schema_node("${json}" TYPE object PATH ${pin}
+      KEYWORDS ${annotations} type properties required additionalProperties)
+  _er_hwinfo_schema_node("${json}" PATH ${pin} properties
+      KEYWORDS description value)
+  _er_hwinfo_schema_node("${json}" TYPE string
+      PATH ${pin} properties description
+      KEYWORDS ${annotations} type maxLength)
+  _er_hwinfo_schema_node("${json}" TYPE integer
+      PATH ${pin} properties value
+      KEYWORDS ${annotations} type minimum maximum)
+  foreach(node types pins)
+    string(JSON kind ERROR_VARIABLE err TYPE "${json}" ${${node}}
+           propertyNames)
+    if(NOT err)
+      _er_hwinfo_schema_node("${json}" PATH ${${node}} propertyNames
+          KEYWORDS ${annotations} maxLength)
+    endif()
+  endforeach()
+  string(JSON kind ERROR_VARIABLE err TYPE "${json}" ${revisions}
+         propertyNames)
+  if(NOT err)
+    _er_hwinfo_schema_node("${json}" PATH ${revisions} propertyNames
+        KEYWORDS ${annotations} maxLength pattern)
+  endif()
+
+  _er_hwinfo_schema_pattern(ER_HWINFO_REVISION_PATTERN "${json}"
+      ${revisions} propertyNames)
+
+  # Optional revision inheritance: "base" names the revision whose pins are
+  # inherited, "remove" lists inherited pins to drop
+  set(ER_HWINFO_BASE_MAX_LENGTH ${unlimited})
+  set(ER_HWINFO_BASE_PATTERN "false")
+  set(ER_HWINFO_REMOVED_PIN_MAX_LENGTH ${unlimited})
+  string(JSON kind ERROR_VARIABLE err TYPE "${json}" ${revision}
+         properties base)
+  if(err)
+    set(ER_HWINFO_REVISION_BASE "false")
+  else()
+    set(ER_HWINFO_REVISION_BASE "true")
+    _er_hwinfo_schema_node("${json}" TYPE string
+        PATH ${revision} properties base
+        KEYWORDS ${annotations} type pattern maxLength)
+    _er_hwinfo_schema_pattern(ER_HWINFO_BASE_PATTERN "${json}"
+        ${revision} properties base)
+    _er_hwinfo_schema_integer(ER_HWINFO_BASE_MAX_LENGTH "${json}"
+        ${unlimited} ${revision} properties base maxLength)
+  endif()
+  string(JSON kind ERROR_VARIABLE err TYPE "${json}" ${revision}
+         properties remove)
+  if(err)
+    set(ER_HWINFO_REVISION_REMOVE "false")
+  else()
+    set(ER_HWINFO_REVISION_REMOVE "true")
+    _er_hwinfo_schema_node("${json}" TYPE array
+        PATH ${revision} properties remove
+        KEYWORDS ${annotations} type items)
+    _er_hwinfo_schema_node("${json}" TYPE string
+        PATH ${revision} properties remove items
+        KEYWORDS ${annotations} type maxLength)
+    _er_hwinfo_schema_integer(ER_HWINFO_REMOVED_PIN_MAX_LENGTH "${json}"
+        ${unlimited} ${revision} properties remove items maxLength)
+  endif()
+
+  _er_hwinfo_schema_integer(ER_HWINFO_TYPE_NAME_MAX_LENGTH "${json}"
+      ${unlimited} ${types} propertyNames maxLength)
+  _er_hwinfo_schema_integer(ER_HWINFO_REVISION_KEY_MAX_LENGTH "${json}"
+      ${unlimited} ${revisions} propertyNames maxLength)
+  _er_hwinfo_schema_integer(ER_HWINFO_PIN_NAME_MAX_LENGTH "${json}"
+      ${unlimited} ${pins} propertyNames maxLength)
+  _er_hwinfo_schema_integer(ER_HWINFO_DESCRIPTION_MAX_LENGTH "${json}"
+      ${unlimited} ${pin} properties description maxLength)
+  _er_hwinfo_schema_integer(ER_HWINFO_PIN_VALUE_MINIMUM "${json}"
+      "std::numeric_limits<std::int64_t>::min()"
+      ${pin} properties value minimum)
+  _er_hwinfo_schema_integer(ER_HWINFO_PIN_VALUE_MAXIMUM "${json}"
+      "std::numeric_limits<std::int64_t>::max()"
+      ${pin} properties value maximum)
+  _er_hwinfo_schema_additional(ER_HWINFO_REVISION_ADDITIONAL "${json}"
+      ${revision})
+  _er_hwinfo_schema_additional(ER_HWINFO_PIN_ADDITIONAL "${json}" ${pin})
+  _er_hwinfo_schema_required(ER_HWINFO_REVISION "${json}"
+      PATH ${revision} KEYS pins)
+  _er_hwinfo_schema_required(ER_HWINFO_PIN "${json}"
+      PATH ${pin} KEYS description value)
+
+  get_filename_component(ER_HWINFO_SCHEMA_SOURCE "${schema}" NAME)
+  configure_file(${_ER_HWINFO_SCHEMA_TEMPLATE} "${output}" @ONLY)
+endfunction()
+
+if(CMAKE_SCRIPT_MODE_FILE AND DEFINED SCHEMA AND DEFINED OUTPUT)
+  er_hwinfo_compile_schema("${SCHEMA}" "${OUTPUT}")
+endif()
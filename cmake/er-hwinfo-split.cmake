@@ -0,0 +1,85 @@
+# Splits a hardware database into a hwdb.d directory: one <type>.json
+# fragment per hardware type, holding that type as written, and a
+# manifest.json listing the types, see er::hwinfo::load_type().
+#
+# Fragments are rewritten only when their contents change, and fragments of
+# types no longer in the database are removed.
+#
+# The hwdb is parsed with CMake's string(JSON), which may be stricter than
+# er::hwinfo: depending on the CMake version, the comments and trailing
+# commas that loading accepts are rejected. Keep split databases strict
+# JSON; anything string(JSON) rejects fails the split with its error.
+#
+# Usable from a project:
+#   er_hwinfo_split_hwdb(<hwdb> <output-dir>)
+# or standalone:
+#   cmake -DHWDB=<hwdb> -DOUTPUT_DIR=<output-dir> -P er-hwinfo-split.cmake
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  cmake_minimum_required(VERSION 3.22)
+endif()
+
+# Sets out to text quoted as a JSON string
+function(_er_hwinfo_json_string out text)
+  string(REPLACE "\\" "\\\\" text "${text}")
+  string(REPLACE "\"" "\\\"" text "${text}")
+  set(${out} "\"${text}\"" PARENT_SCOPE)
+endfunction()
+
+# Writes content to file unless it already holds it
+function(_er_hwinfo_write_if_changed file content)
+  if(EXISTS "${file}")
+    file(READ "${file}" current)
+    if(current STREQUAL content)
+      return()
+    endif()
+  endif()
+  file(WRITE "${file}" "${content}")
+endfunction()
+
+function(er_hwinfo_split_hwdb hwdb output_dir)
+  file(READ "${hwdb}" json)
+  string(JSON kind ERROR_VARIABLE err TYPE "${json}")
+  if(err)
+    message(FATAL_ERROR
+        "hwdb: ${hwdb} cannot be parsed by CMake's string(JSON): ${err}\n"
+        "Splitting into hwdb.d needs strict JSON; remove any comments and "
+        "trailing commas, which loading accepts but this CMake may not.")
+  endif()
+  if(NOT kind STREQUAL "OBJECT")
+    message(FATAL_ERROR "hwdb: ${hwdb} must be an object of hardware types")
+  endif()
+
+  file(MAKE_DIRECTORY "${output_dir}")
+  file(GLOB stale "${output_dir}/*.json")
+  set(manifest "[]")
+  string(JSON count LENGTH "${json}")
+  if(count GREATER 0)
+    math(EXPR last "${count} - 1")
+    foreach(i RANGE ${last})
+      string(JSON type MEMBER "${json}" ${i})
+      # Same rule as er::hwinfo::impl::is_fragment_name()
+      if(type STREQUAL "" OR type STREQUAL "." OR type STREQUAL ".." OR
+         type STREQUAL "manifest" OR type MATCHES "/")
+        message(FATAL_ERROR
+            "hwdb: hardware type \"${type}\" cannot name a fragment file")
+      endif()
+      string(JSON revisions GET "${json}" "${type}")
+      string(JSON fragment SET "{}" "${type}" "${revisions}")
+      _er_hwinfo_json_string(name "${type}")
+      string(JSON manifest SET "${manifest}" ${i} "${name}")
+      set(file "${output_dir}/${type}.json")
+      _er_hwinfo_write_if_changed("${file}" "${fragment}\n")
+      list(REMOVE_ITEM stale "${file}")
+    endforeach()
+  endif()
+  _er_hwinfo_write_if_changed("${output_dir}/manifest.json" "${manifest}\n")
+  list(REMOVE_ITEM stale "${output_dir}/manifest.json")
+  if(stale)
+    file(REMOVE ${stale})
+  endif()
+endfunction()
+
+if(CMAKE_SCRIPT_MODE_FILE AND DEFINED HWDB AND DEFINED OUTPUT_DIR)
+  er_hwinfo_split_hwdb("${HWDB}" "${OUTPUT_DIR}")
+endif()
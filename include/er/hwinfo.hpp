@@ -1,24 +1,73 @@
 #pragma once
 
 #include <algorithm>
-#include <charconv>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <concepts>
+#include <coroutine>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <numeric>
 #include <optional>
 #include <ranges>
 #include <set>
+#include <shared_mutex>
+#include <span>
 #include <stdexcept>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
 
 #include <rapidjson/document.h>
 #include <rapidjson/error/en.h>
-#include <rapidjson/istreamwrapper.h>
+#include <rapidjson/memorystream.h>
+#include <rapidjson/reader.h>
 #include <rapidjson/schema.h>
 #include <rapidjson/stringbuffer.h>
 
 #include <arpa/inet.h>
 
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define ER_HWINFO_HAS_IO_URING
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__AVX2__) || defined(__SSE4_2__))
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#if defined(ER_HWINFO_ZSTD)
+#include <zstd.h>
+#endif
+
+#include <er/hwinfo/hwdb_schema.hpp>
+
 #include <fmt/format.h>
 
 /**
@@ -53,6 +102,102 @@ struct revision {
   }
 };
 
+/**
+ * @brief String of at most Capacity bytes, stored inline.
+ *
+ * A trivially copyable stand-in for std::string: pin and device use it when
+ * built with ER_HWINFO_INLINE_STRINGS, so that results can be copied with
+ * memcpy into shared memory or IPC buffers and never allocate. Always null
+ * terminated. Converts to std::string_view and compares like one.
+ */
+template <std::size_t Capacity> class fixed_string {
+  static_assert(Capacity <= std::numeric_limits<std::uint16_t>::max(),
+                "fixed_string needs a bounded capacity; with "
+                "ER_HWINFO_INLINE_STRINGS, hwdb-schema.json must set "
+                "maxLength on type names, pin names and descriptions");
+
+public:
+  static constexpr std::size_t capacity = Capacity; ///< Maximum size
+
+  constexpr fixed_string() noexcept = default;
+
+  /// From a string literal that fits, checked at compile time
+  template <std::size_t N>
+  constexpr fixed_string(char const (&literal)[N]) noexcept {
+    static_assert(N - 1 <= Capacity, "string literal exceeds the capacity");
+    assign(std::string_view(literal, N - 1));
+  }
+
+  /// From text, truncated to the capacity. Use assign() to detect overflow.
+  constexpr explicit fixed_string(std::string_view text) noexcept {
+    assign(text.substr(0, std::min(text.size(), Capacity)));
+  }
+
+  /// @brief Replace the contents with text.
+  /// @return false, leaving the contents unchanged, if text does not fit
+  constexpr bool assign(std::string_view text) noexcept {
+    if (text.size() > Capacity) {
+      return false;
+    }
+    std::ranges::copy(text, chars_.begin());
+    chars_[text.size()] = '\0';
+    size_ = static_cast<std::uint16_t>(text.size());
+    return true;
+  }
+
+  constexpr std::size_t size() const noexcept { return size_; }
+  constexpr bool empty() const noexcept { return size_ == 0; }
+  constexpr char const *data() const noexcept { return chars_.data(); }
+  constexpr char const *c_str() const noexcept { return chars_.data(); }
+  constexpr std::string_view view() const noexcept { return {data(), size_}; }
+  constexpr operator std::string_view() const noexcept { return view(); }
+
+  template <std::size_t N>
+  friend constexpr bool operator==(fixed_string const &a,
+                                   fixed_string<N> const &b) noexcept {
+    return a.view() == b.view();
+  }
+  template <std::size_t N>
+  friend constexpr auto operator<=>(fixed_string const &a,
+                                    fixed_string<N> const &b) noexcept {
+    return a.view() <=> b.view();
+  }
+  friend constexpr bool operator==(fixed_string const &a,
+                                   std::string_view b) noexcept {
+    return a.view() == b;
+  }
+  friend constexpr auto operator<=>(fixed_string const &a,
+                                    std::string_view b) noexcept {
+    return a.view() <=> b;
+  }
+  friend std::ostream &operator<<(std::ostream &out, fixed_string const &s) {
+    return out << s.view();
+  }
+
+private:
+  std::array<char, Capacity + 1> chars_{};
+  std::uint16_t size_ = 0;
+};
+
+#if defined(ER_HWINFO_INLINE_STRINGS)
+/// @brief Storage of device::hw_type, bounded by the schema
+using type_name_string =
+    fixed_string<generated::hwdb_schema::type_name_max_length>;
+/// @brief Storage of pin::name, bounded by the schema
+using pin_name_string =
+    fixed_string<generated::hwdb_schema::pin_name_max_length>;
+/// @brief Storage of pin::description, bounded by the schema
+using description_string =
+    fixed_string<generated::hwdb_schema::description_max_length>;
+#else
+/// @brief Storage of device::hw_type, see ER_HWINFO_INLINE_STRINGS
+using type_name_string = std::string;
+/// @brief Storage of pin::name, see ER_HWINFO_INLINE_STRINGS
+using pin_name_string = std::string;
+/// @brief Storage of pin::description, see ER_HWINFO_INLINE_STRINGS
+using description_string = std::string;
+#endif
+
 /**
  * @brief GPIO pin definition.
  *
@@ -60,9 +205,9 @@ struct revision {
  * GPIO number, and human-readable description.
  */
 struct pin {
-  std::string name;        ///< Pin identifier (e.g., "LED", "BUTTON")
-  std::size_t number;      ///< GPIO pin number (0-255)
-  std::string description; ///< Human-readable description of the pin's purpose
+  pin_name_string name;           ///< Pin identifier (e.g., "LED", "BUTTON")
+  std::size_t number;             ///< GPIO pin number (0-255)
+  description_string description; ///< Human-readable description of the pin
 };
 
 /**
@@ -71,8 +216,8 @@ struct pin {
  * Contains the hardware type name and revision as read from the device tree.
  */
 struct device {
-  std::string hw_type;  ///< Hardware type identifier (e.g., "mrcm")
-  revision hw_revision; ///< Hardware revision
+  type_name_string hw_type; ///< Hardware type identifier (e.g., "mrcm")
+  revision hw_revision;     ///< Hardware revision
 };
 
 /// @brief Comparator for ordering pins by name, with transparent lookup support
@@ -103,233 +248,4022 @@ struct info {
   pin_set pins; ///< GPIO pin definitions (may be empty if revision not found)
 };
 
+/// @brief Interned pin descriptions, shared by the pin maps of a database.
+/// A node-based set, so descriptions never move once interned.
+using description_pool = std::set<std::string, std::less<>>;
+
+/**
+ * @brief Pin definitions of one revision of a loaded database.
+ *
+ * Laid out for resolving pins by name: the names, sorted and packed into
+ * one buffer, and the GPIO numbers, one byte each, are kept apart from the
+ * descriptions, which only description(), at() and to_pin_set() touch.
+ * Finding a pin reads a couple of cache lines however long the
+ * descriptions are. Descriptions are interned in a description_pool, so
+ * that each distinct text is stored once per database.
+ */
+class pin_map {
+public:
+  pin_map() = default;
+
+  /// @brief Build the map of pins, reordering them by name.
+  /// If several pins share a name the first one wins. Numbers must be at
+  /// most 255.
+  explicit pin_map(std::span<pin> pins)
+      : pin_map(pins, std::make_shared<description_pool>()) {}
+
+  /// @brief Build the map of pins, interning descriptions in pool.
+  /// @see pin_map(std::span<pin>)
+  pin_map(std::span<pin> pins, std::shared_ptr<description_pool> pool)
+      : pool_(pool) {
+    std::ranges::stable_sort(pins, pin_compare{});
+    const auto dups = std::ranges::unique(pins, {}, &pin::name);
+    const auto count = pins.size() - dups.size();
+    name_ends_.reserve(count);
+    numbers_.reserve(count);
+    descriptions_.reserve(count);
+    for (auto const &p : pins.first(count)) {
+      names_ += std::string_view(p.name);
+      name_ends_.push_back(static_cast<std::uint32_t>(names_.size()));
+      numbers_.push_back(static_cast<std::uint8_t>(p.number));
+      const std::string_view description(p.description);
+      auto interned = pool->find(description);
+      if (interned == pool->end()) {
+        interned = pool->emplace(description).first;
+      }
+      descriptions_.emplace_back(*interned);
+    }
+  }
+
+  std::size_t size() const noexcept { return numbers_.size(); }
+  bool empty() const noexcept { return numbers_.empty(); }
+
+  /// @brief Name of the i-th pin; pins are sorted by name.
+  std::string_view name(std::size_t i) const noexcept {
+    const std::size_t first = i == 0 ? 0 : name_ends_[i - 1];
+    return std::string_view(names_).substr(first, name_ends_[i] - first);
+  }
+
+  /// @brief GPIO number of the i-th pin.
+  std::uint8_t number(std::size_t i) const noexcept { return numbers_[i]; }
+
+  /// @brief Description of the i-th pin.
+  std::string_view description(std::size_t i) const noexcept {
+    return descriptions_[i];
+  }
+
+  /// @brief Find a pin by name.
+  /// @return Index of the pin, or size() if there is no such pin
+  std::size_t find(std::string_view pin_name) const noexcept {
+    std::size_t first = 0;
+    for (auto length = size(); length > 0;) {
+      const auto half = length / 2;
+      if (name(first + half) < pin_name) {
+        first += half + 1;
+        length -= half + 1;
+      } else {
+        length = half;
+      }
+    }
+    return first < size() && name(first) == pin_name ? first : size();
+  }
+
+  /// @brief Copy of the i-th pin.
+  pin at(std::size_t i) const {
+    return pin{.name = pin_name_string(name(i)),
+               .number = number(i),
+               .description = description_string(description(i))};
+  }
+
+  /// @brief Copy the pins into a pin_set.
+  pin_set to_pin_set() const {
+    pin_set pins;
+    for (std::size_t i = 0; i < size(); ++i) {
+      pins.insert(pins.end(), at(i));
+    }
+    return pins;
+  }
+
+  /// Same pins, numbers and descriptions
+  friend bool operator==(pin_map const &a, pin_map const &b) noexcept {
+    return a.names_ == b.names_ && a.name_ends_ == b.name_ends_ &&
+           a.numbers_ == b.numbers_ && a.descriptions_ == b.descriptions_;
+  }
+
+private:
+  std::vector<std::uint32_t> name_ends_; ///< End of each name in names_
+  std::vector<std::uint8_t> numbers_;
+  std::string names_;
+  /// Read only when descriptions are requested
+  std::vector<std::string_view> descriptions_;
+  std::shared_ptr<const description_pool> pool_; ///< Owns descriptions_
+};
+
+/**
+ * @brief Reusable storage for loading the hardware database.
+ *
+ * Keeps the file contents, the parser stack and the memory of the schema
+ * document, each grown to what the previous load needed, so that reloading
+ * a database of similar size only allocates the memory retained by the new
+ * database index. load_database() keeps one instance per thread unless an
+ * instance is passed explicitly.
+ */
+struct parse_buffers {
+  std::string text;          ///< Contents of the file being parsed
+  std::vector<char> stack;   ///< Backing store of the parser stack
+  std::vector<char> scratch; ///< Backing store of the schema document
+  std::vector<char> window;  ///< Decompressed text of a compressed file
+};
+
+/**
+ * @brief Selects the schema compiled into the library.
+ *
+ * Passed instead of a schema path, see load_database(). The database is
+ * then validated against the hwdb-schema.json the library was built with,
+ * by a validator specialised for it, and no schema file is read.
+ */
+struct builtin_schema_t {
+  explicit builtin_schema_t() = default;
+};
+
+/// @brief Selects the schema compiled into the library.
+inline constexpr builtin_schema_t builtin_schema{};
+
+/// @brief Reason an operation of the non-throwing API failed.
+enum class errc : std::uint8_t {
+  no_device,            ///< The device tree holds no device identification
+  file_open_failed,     ///< A JSON file could not be opened
+  file_read_failed,     ///< A JSON file could not be read
+  file_write_failed,    ///< An offset index could not be written
+  unsupported_compression, ///< A compressed file needs ER_HWINFO_ZSTD
+  decompression_failed, ///< A compressed file is corrupt or truncated
+  parse_failed,         ///< A JSON file is not well-formed
+  schema_violation,     ///< The database does not conform to the schema
+  invalid_revision,     ///< A revision key is not major.minor.patch
+  revision_out_of_range, ///< A revision key exceeds the packed range
+  string_too_long, ///< A name or description exceeds its inline storage
+  gpio_out_of_range, ///< A GPIO number exceeds 255
+  invalid_base, ///< A base revision is unknown or derives from itself
+  invalid_manifest ///< A hwdb.d manifest is not an array of type names
+};
+
+/**
+ * @brief Failure reported by the non-throwing API.
+ *
+ * The code tells what failed, offset and detail where: detail is the file
+ * for file errors, the parser message for parse errors, the pointer to the
+ * violated schema location for schema violations, the key for revision
+ * errors and the type and revision for base errors. offset is the byte
+ * offset into the file, or into the key for revision errors.
+ */
+struct error {
+  errc code;              ///< What failed
+  std::size_t offset = 0; ///< Byte offset of the failure in its input
+  std::string detail;     ///< File, parser message, schema pointer or key
+
+  /// @brief Describes the failure as the throwing API reports it.
+  std::string message() const;
+};
+
+/**
+ * @brief Value or error, returned by the non-throwing API.
+ *
+ * A minimal std::expected. Accessing the value of a failed result or the
+ * error of a successful one is undefined.
+ */
+template <typename T> class [[nodiscard]] result {
+public:
+  result(T value) : state_(std::in_place_index<0>, std::move(value)) {}
+  result(hwinfo::error err) : state_(std::in_place_index<1>, std::move(err)) {}
+
+  bool has_value() const noexcept { return state_.index() == 0; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  T &value() & noexcept { return *std::get_if<0>(&state_); }
+  T const &value() const & noexcept { return *std::get_if<0>(&state_); }
+  T &&value() && noexcept { return std::move(*std::get_if<0>(&state_)); }
+
+  T &operator*() & noexcept { return value(); }
+  T const &operator*() const & noexcept { return value(); }
+  T &&operator*() && noexcept { return std::move(*this).value(); }
+  T *operator->() noexcept { return &value(); }
+  T const *operator->() const noexcept { return &value(); }
+
+  hwinfo::error const &error() const noexcept {
+    return *std::get_if<1>(&state_);
+  }
+
+private:
+  std::variant<T, hwinfo::error> state_;
+};
+
+/// @brief Success or error, returned by non-throwing operations without a
+///        value.
+template <> class [[nodiscard]] result<void> {
+public:
+  result() = default;
+  result(hwinfo::error err) : error_(std::move(err)) {}
+
+  bool has_value() const noexcept { return !error_; }
+  explicit operator bool() const noexcept { return has_value(); }
+
+  hwinfo::error const &error() const noexcept { return *error_; }
+
+private:
+  std::optional<hwinfo::error> error_;
+};
+
+/// @brief Counters of the pin cache of a database, see
+///        database::cached_pins().
+struct pin_cache_stats {
+  std::uint64_t hits = 0;   ///< Lookups answered from the cache
+  std::uint64_t misses = 0; ///< Lookups that resolved the pins
+  std::size_t size = 0;     ///< Devices currently cached
+  std::size_t capacity = 0; ///< Devices cached at most
+};
+
 namespace impl {
 namespace rg = std::ranges;
 namespace rgv = std::ranges::views;
 
-inline std::optional<device>
-get_device(std::filesystem::path const &dt_base_path) {
-  using std::filesystem::exists;
-  const auto er_base_path = dt_base_path / "effective-range,hardware";
-  const auto type_path = er_base_path / "effective-range,type";
-  const auto rev_major_path = er_base_path / "effective-range,revision-major";
-  const auto rev_minor_path = er_base_path / "effective-range,revision-minor";
-  const auto rev_patch_path = er_base_path / "effective-range,revision-patch";
-  if (!exists(type_path) || !exists(rev_major_path) ||
-      !exists(rev_minor_path) || !exists(rev_patch_path)) {
-    return std::nullopt;
+/// Reports err the way the throwing API does: as std::runtime_error, or
+/// on stderr followed by std::abort() if exceptions are disabled
+[[noreturn]] inline void throw_error(error const &err) {
+#if defined(__cpp_exceptions)
+  throw std::runtime_error(err.message());
+#else
+  std::fputs(err.message().c_str(), stderr);
+  std::fputc('\n', stderr);
+  std::abort();
+#endif
+}
+
+/// The value of res, reporting its error as throw_error() does
+template <typename T> T value_or_throw(result<T> &&res) {
+  if (!res) {
+    throw_error(res.error());
   }
+  return std::move(res).value();
+}
 
-  std::ifstream type_file(type_path);
-  std::string hw_type;
-  type_file >> hw_type;
-  if (hw_type.empty()) {
+/// The info of res as get() returns it: std::nullopt if there is no
+/// device, other errors reported as throw_error() does
+inline std::optional<info> info_or_throw(result<info> &&res) {
+  if (!res && res.error().code == errc::no_device) {
     return std::nullopt;
   }
-  const auto read_u32 =
-      [](std::filesystem::path const &p) -> std::optional<std::uint32_t> {
-    std::ifstream file(p, std::ios::binary);
-    if (!file) {
-      return std::nullopt;
+  return value_or_throw(std::move(res));
+}
+
+/// Sets out to text; false if text exceeds the capacity of out
+inline bool assign_text(std::string &out, std::string_view text) {
+  out.assign(text);
+  return true;
+}
+
+template <std::size_t Capacity>
+constexpr bool assign_text(fixed_string<Capacity> &out,
+                           std::string_view text) noexcept {
+  return out.assign(text);
+}
+
+/// Result of parse_revision(), in the manner of std::from_chars_result
+struct revision_parse_result {
+  revision rev;          ///< Parsed revision, valid if ec is std::errc()
+  std::errc ec{};        ///< invalid_argument or result_out_of_range on error
+  std::size_t offset{0}; ///< Start of the offending component on error
+};
+
+/// Parses major.minor.patch with a plain digit loop, reporting the first
+/// offending component
+constexpr revision_parse_result
+parse_revision_scalar(std::string_view text) noexcept {
+  revision_parse_result result;
+  std::size_t *const components[] = {&result.rev.major, &result.rev.minor,
+                                     &result.rev.patch};
+  std::size_t pos = 0;
+  for (std::size_t c = 0; c < 3; ++c) {
+    const auto start = pos;
+    std::size_t value = 0;
+    for (; pos < text.size() && text[pos] >= '0' && text[pos] <= '9'; ++pos) {
+      const auto digit = static_cast<std::size_t>(text[pos] - '0');
+      if (value > (std::numeric_limits<std::size_t>::max() - digit) / 10) {
+        return {.rev = {}, .ec = std::errc::result_out_of_range,
+                .offset = start};
+      }
+      value = value * 10 + digit;
     }
-    std::uint32_t value = 0;
-    file.read(reinterpret_cast<char *>(&value), sizeof(value));
-    if (!file) {
-      return std::nullopt;
+    const bool last = c == 2;
+    if (pos == start || (last ? pos != text.size()
+                              : pos == text.size() || text[pos] != '.')) {
+      return {.rev = {}, .ec = std::errc::invalid_argument, .offset = start};
+    }
+    *components[c] = value;
+    pos += last ? 0 : 1;
+  }
+  return result;
+}
+
+/// Loads up to 8 bytes of text into a word, first byte least significant
+inline std::uint64_t load_word(std::string_view text) noexcept {
+  std::uint64_t word = 0;
+  std::memcpy(&word, text.data(), std::min(text.size(), sizeof(word)));
+  if constexpr (std::endian::native == std::endian::big) {
+    word = __builtin_bswap64(word);
+  }
+  return word;
+}
+
+/**
+ * Parses major.minor.patch without exceptions. Keys of up to 8 bytes, such
+ * as "1.0.0" or "12.3.45", are checked a word at a time: one SWAR pass
+ * finds every byte that is not a digit, and a valid key has exactly two,
+ * both dots, with digits around them. Longer keys and all errors take the
+ * scalar parser, so error reporting does not depend on the key length.
+ */
+constexpr revision_parse_result parse_revision(std::string_view text) noexcept {
+  constexpr std::uint64_t ones = 0x0101010101010101ULL;
+  constexpr std::size_t min_size = 5;
+  if (std::is_constant_evaluated() || text.size() < min_size ||
+      text.size() > sizeof(std::uint64_t)) {
+    return parse_revision_scalar(text);
+  }
+  // digits become 0..9, every other byte is larger
+  const auto values = load_word(text) ^ (ones * '0');
+  const auto high = ones * 0x80;
+  auto non_digits = (((values & ~high) + ones * 0x76) | values) & high;
+  if (text.size() < sizeof(std::uint64_t)) {
+    non_digits &= (std::uint64_t{1} << (8 * text.size())) - 1;
+  }
+  const auto first_dot =
+      static_cast<std::size_t>(std::countr_zero(non_digits)) / 8;
+  const auto second_dot = static_cast<std::size_t>(
+      std::countr_zero(non_digits & (non_digits - 1))) / 8;
+  if (std::popcount(non_digits) != 2 || first_dot == 0 ||
+      second_dot == first_dot + 1 || second_dot + 1 == text.size() ||
+      text[first_dot] != '.' || text[second_dot] != '.') {
+    return parse_revision_scalar(text);
+  }
+  const auto component = [&](std::size_t first, std::size_t last) {
+    std::size_t value = 0;
+    for (auto i = first; i < last; ++i) {
+      value = value * 10 + ((values >> (8 * i)) & 0xff);
     }
-    value = ntohl(value);
     return value;
   };
+  return {.rev = {.major = component(0, first_dot),
+                  .minor = component(first_dot + 1, second_dot),
+                  .patch = component(second_dot + 1, text.size())},
+          .ec = std::errc(),
+          .offset = 0};
+}
+
+/// parse_revision() reporting failure as an error
+inline result<revision> try_extract_revision(std::string_view text) {
+  const auto parsed = parse_revision(text);
+  if (parsed.ec != std::errc()) {
+    return error{.code = errc::invalid_revision,
+                 .offset = parsed.offset,
+                 .detail = std::string(text)};
+  }
+  return parsed.rev;
+}
+
+/// Throwing wrapper of parse_revision()
+/// @throws std::runtime_error if text is not major.minor.patch
+inline revision extract_revision(std::string_view text) {
+  return value_or_throw(try_extract_revision(text));
+}
 
-  const auto rev_major = read_u32(rev_major_path);
-  const auto rev_minor = read_u32(rev_minor_path);
-  const auto rev_patch = read_u32(rev_patch_path);
-  if (!rev_major || !rev_minor || !rev_patch) {
+/// Applies the revision matching rules of get() to revisions sorted in
+/// ascending order. Returns the selected element, or end if none matches.
+template <rg::forward_range Range, typename Proj = std::identity>
+constexpr auto select_revision(Range const &sorted, revision requested,
+                               Proj proj = {}) {
+  const auto first = rg::begin(sorted);
+  const auto last = rg::end(sorted);
+  const auto iter = rg::lower_bound(first, last, requested, {}, proj);
+  if (iter != last &&
+      std::invoke(proj, *iter).major == requested.major) {
+    return iter;
+  }
+  if (iter != first &&
+      std::invoke(proj, *std::prev(iter)).major == requested.major) {
+    return std::prev(iter);
+  }
+  return last;
+}
+
+/// Revision packed into 16 bits of major and 24 bits each of minor and
+/// patch, so that revisions are ordered by a single integer compare
+using revision_key = std::uint64_t;
+
+constexpr std::size_t revision_major_max = 0xffff;
+constexpr std::size_t revision_component_max = 0xffffff;
+
+/// Packs rev, or returns std::nullopt if a component does not fit
+constexpr std::optional<revision_key> pack_revision(revision rev) noexcept {
+  if (rev.major > revision_major_max || rev.minor > revision_component_max ||
+      rev.patch > revision_component_max) {
     return std::nullopt;
   }
+  return (revision_key{rev.major} << 48) | (revision_key{rev.minor} << 24) |
+         revision_key{rev.patch};
+}
 
-  return device{
-      .hw_type = hw_type,
-      .hw_revision =
-          revision{
-              .major = *rev_major,
-              .minor = *rev_minor,
-              .patch = *rev_patch,
-          },
-  };
+constexpr revision unpack_revision(revision_key key) noexcept {
+  return revision{.major = static_cast<std::size_t>(key >> 48),
+                  .minor = static_cast<std::size_t>(key >> 24) &
+                           revision_component_max,
+                  .patch = static_cast<std::size_t>(key) &
+                           revision_component_max};
 }
 
-inline std::pair<std::size_t, const char *>
-extract_revision_component(const char *first, const char *last, bool last_rev) {
-  std::size_t value = 0;
-  const auto res = std::from_chars(first, last, value);
-  if (res.ec != std::errc() || (last_rev && res.ptr != last) ||
-      (!last_rev && *res.ptr != '.')) {
-    throw std::runtime_error(
-        fmt::format("Invalid revision string component: {}",
-                    std::string_view(first, last)));
+constexpr revision_key revision_major(revision_key key) noexcept {
+  return key >> 48;
+}
+
+/// Packs a requested revision for select_revision_key(), which selects
+/// the same revision for the packed key as for rev. A minor version beyond
+/// the packed range becomes major.max.max: every stored revision of the
+/// major version precedes rev, and none but major.max.max itself lies
+/// between the two, which is then selected either way. A patch beyond it
+/// becomes the successor major.(minor + 1).0, the first key after every
+/// major.minor.x, or major.max.max if minor is the largest. Returns
+/// std::nullopt if the major version is out of range, as no stored
+/// revision can match it.
+constexpr std::optional<revision_key> pack_request(revision rev) noexcept {
+  if (rev.major > revision_major_max) {
+    return std::nullopt;
+  }
+  if (rev.minor > revision_component_max) {
+    rev.minor = revision_component_max;
+    rev.patch = revision_component_max;
+  } else if (rev.patch > revision_component_max) {
+    if (rev.minor < revision_component_max) {
+      ++rev.minor;
+      rev.patch = 0;
+    } else {
+      rev.patch = revision_component_max;
+    }
   }
-  return {value, res.ptr + (last_rev ? 0 : 1)};
+  return pack_revision(rev);
 }
 
-inline revision extract_revision(std::string_view rev_str) {
-  revision rev{0, 0, 0};
-  const char *first = rev_str.begin();
-  const char *const last = rev_str.end();
-  std::tie(rev.major, first) = extract_revision_component(first, last, false);
-  std::tie(rev.minor, first) = extract_revision_component(first, last, false);
-  std::tie(rev.patch, first) = extract_revision_component(first, last, true);
-  return rev;
+/// Instruction set used by count_less(): "avx2", "sse4.2", "neon" or
+/// "scalar", chosen at compile time from the target flags
+constexpr std::string_view revision_search_isa =
+#if defined(__x86_64__) && defined(__AVX2__)
+    "avx2";
+#elif defined(__x86_64__) && defined(__SSE4_2__)
+    "sse4.2";
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    "neon";
+#else
+    "scalar";
+#endif
+
+/// Number of keys less than key, portable reference for count_less()
+constexpr std::size_t count_less_scalar(std::span<const revision_key> keys,
+                                        revision_key key) noexcept {
+  std::size_t count = 0;
+  for (const auto k : keys) {
+    count += k < key ? 1 : 0;
+  }
+  return count;
 }
 
-template <auto Flags>
-rapidjson::Document read_document(std::filesystem::path const &path) {
-  rapidjson::Document doc;
-  std::ifstream file(path);
-  if (!file) {
-    throw std::runtime_error(
-        fmt::format("Failed to open json file: {}", path.string()));
+/// Number of keys less than key, comparing several keys per instruction.
+/// x86 only has signed 64-bit compares (SSE4.2 and later), so keys are
+/// biased by the sign bit first.
+inline std::size_t count_less(std::span<const revision_key> keys,
+                              revision_key key) noexcept {
+  std::size_t i = 0;
+  std::size_t count = 0;
+#if defined(__x86_64__) && (defined(__AVX2__) || defined(__SSE4_2__))
+  constexpr auto bias = static_cast<long long>(0x8000000000000000ULL);
+  const auto needle = static_cast<long long>(key) ^ bias;
+#endif
+#if defined(__x86_64__) && defined(__AVX2__)
+  const __m256i bias4 = _mm256_set1_epi64x(bias);
+  const __m256i needle4 = _mm256_set1_epi64x(needle);
+  __m256i acc4 = _mm256_setzero_si256();
+  for (; i + 4 <= keys.size(); i += 4) {
+    const __m256i v = _mm256_xor_si256(
+        _mm256_loadu_si256(
+            reinterpret_cast<__m256i const *>(keys.data() + i)),
+        bias4);
+    // all ones (-1) in each lane holding a smaller key
+    acc4 = _mm256_sub_epi64(acc4, _mm256_cmpgt_epi64(needle4, v));
+  }
+  const __m128i acc2 = _mm_add_epi64(_mm256_castsi256_si128(acc4),
+                                     _mm256_extracti128_si256(acc4, 1));
+  count = static_cast<std::size_t>(_mm_cvtsi128_si64(acc2) +
+                                   _mm_extract_epi64(acc2, 1));
+#elif defined(__x86_64__) && defined(__SSE4_2__)
+  const __m128i bias2 = _mm_set1_epi64x(bias);
+  const __m128i needle2 = _mm_set1_epi64x(needle);
+  __m128i acc2 = _mm_setzero_si128();
+  for (; i + 2 <= keys.size(); i += 2) {
+    const __m128i v = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(keys.data() + i)),
+        bias2);
+    acc2 = _mm_sub_epi64(acc2, _mm_cmpgt_epi64(needle2, v));
   }
-  rapidjson::IStreamWrapper sstream(file);
-  if (auto &result = doc.ParseStream<Flags>(sstream); result.HasParseError()) {
-    throw std::runtime_error(
-        fmt::format("Failed to parse JSON file: {} ({})",
-                    rapidjson::GetParseError_En(result.GetParseError()),
-                    result.GetErrorOffset()));
+  count = static_cast<std::size_t>(_mm_cvtsi128_si64(acc2) +
+                                   _mm_extract_epi64(acc2, 1));
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+  const uint64x2_t needle2 = vdupq_n_u64(key);
+  uint64x2_t acc2 = vdupq_n_u64(0);
+  for (; i + 2 <= keys.size(); i += 2) {
+    acc2 = vsubq_u64(acc2, vcltq_u64(vld1q_u64(keys.data() + i), needle2));
   }
-  return doc;
+  count = static_cast<std::size_t>(vaddvq_u64(acc2));
+#endif
+  return count + count_less_scalar(keys.subspan(i), key);
 }
 
-inline void validate_json(rapidjson::Document const &doc,
-                          rapidjson::Document &schema_doc) {
-  rapidjson::SchemaDocument schema(schema_doc);
-  rapidjson::SchemaValidator validator(schema);
-  if (!doc.Accept(validator)) {
-    rapidjson::StringBuffer sb;
-    validator.GetInvalidSchemaPointer().StringifyUriFragment(sb);
-    throw std::runtime_error(
-        fmt::format("JSON does not conform to schema: {}", sb.GetString()));
+/// Keys left for a linear count once the binary search has narrowed the
+/// range, a few cache lines
+constexpr std::size_t linear_search_keys = 32;
+
+/// Index of the first key not less than key. A binary search without data
+/// dependent branches narrows the range to linear_search_keys, which are
+/// then counted with count_less().
+constexpr std::size_t lower_bound_key(std::span<const revision_key> keys,
+                                      revision_key key) noexcept {
+  std::size_t first = 0;
+  std::size_t length = keys.size();
+  while (length > linear_search_keys) {
+    const auto half = length / 2;
+    first = keys[first + half - 1] < key ? first + half : first;
+    length -= half;
   }
+  const auto window = keys.subspan(first, length);
+  return first + (std::is_constant_evaluated() ? count_less_scalar(window, key)
+                                               : count_less(window, key));
 }
 
-template <auto Flags>
-inline rapidjson::Document
-read_and_validate_json(std::filesystem::path const &json_path,
-                       std::filesystem::path const &schema_path) {
-  rapidjson::Document schema = read_document<Flags>(schema_path);
-  rapidjson::Document doc = read_document<Flags>(json_path);
-  validate_json(doc, schema);
-  return doc;
-}
-
-inline auto resolve_revision(revision requested, auto const &type_entry) {
-
-  auto &&revs = rg::subrange(type_entry.GetObject().MemberBegin(),
-                             type_entry.GetObject().MemberEnd()) |
-                rgv::transform([](auto const &m) {
-                  return impl::extract_revision(m.name.GetString());
-                });
-  std::set<revision> revisions(rg::begin(revs), rg::end(revs));
-  auto revision_iter = revisions.lower_bound(requested);
-
-  if (revision_iter == revisions.end() ||
-      (*revision_iter != requested &&
-       revision_iter->major != requested.major)) {
-    auto found_iter = std::find_if(
-        std::make_reverse_iterator(revision_iter), revisions.rend(),
-        [&](revision const &rev) { return rev.major == requested.major; });
-    if (found_iter == revisions.rend()) {
-      return type_entry.GetObject().MemberEnd();
-    }
-    revision_iter = --found_iter.base();
-  }
-  const auto hwrevision_iter =
-      type_entry.GetObject().FindMember(revision_iter->as_string().c_str());
-  if (hwrevision_iter == type_entry.GetObject().MemberEnd()) {
-    throw std::logic_error(
-        fmt::format("Inconsistent hardware database: computed revision "
-                    "{} not found",
-                    revision_iter->as_string()));
-  }
-  return hwrevision_iter;
+/// select_revision() over sorted packed keys. Returns the index of the
+/// selected revision, or keys.size() if none matches.
+constexpr std::size_t select_revision_key(std::span<const revision_key> keys,
+                                          revision_key requested) noexcept {
+  const auto iter = lower_bound_key(keys, requested);
+  const auto major = revision_major(requested);
+  if (iter < keys.size() && revision_major(keys[iter]) == major) {
+    return iter;
+  }
+  if (iter > 0 && revision_major(keys[iter - 1]) == major) {
+    return iter - 1;
+  }
+  return keys.size();
 }
 
-} // namespace impl
+/// splitmix64 finalizer, spreads every input bit over the whole word
+constexpr std::uint64_t mix_bits(std::uint64_t x) noexcept {
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+/// 64-bit FNV-1a hash of a name or other text, finalized so that all bits
+/// are usable
+constexpr std::uint64_t name_hash(std::string_view name) noexcept {
+  std::uint64_t hash = 0xcbf29ce484222325ULL;
+  for (const char c : name) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ULL;
+  }
+  return mix_bits(hash);
+}
+
+/// Maps x onto [0, n) with a multiply instead of a division
+constexpr std::size_t reduce(std::uint32_t x, std::size_t n) noexcept {
+  return static_cast<std::size_t>((std::uint64_t{x} * n) >> 32);
+}
+
+/// Bucket of a name hash in a perfect hash table
+constexpr std::size_t hash_bucket(std::uint64_t hash,
+                                  std::size_t buckets) noexcept {
+  return reduce(static_cast<std::uint32_t>(hash), buckets);
+}
+
+/// Slot of a name hash, displaced by the seed of its bucket
+constexpr std::size_t hash_slot(std::uint64_t hash, std::uint32_t seed,
+                                std::size_t slots) noexcept {
+  const auto x =
+      mix_bits(hash ^ (std::uint64_t{seed} * 0x9e3779b97f4a7c15ULL));
+  return reduce(static_cast<std::uint32_t>(x >> 32), slots);
+}
+
+/// Minimal perfect hash over a set of names
+struct perfect_hash {
+  std::vector<std::uint32_t> seeds; ///< Seed of each bucket
+  std::vector<std::size_t> slots;   ///< Slot assigned to each input name
+};
+
+/// Builds a minimal perfect hash by hash-and-displace: buckets are placed
+/// largest first, each with the first seed that maps all of its names to
+/// free slots. Returns std::nullopt if names are not distinct.
+inline std::optional<perfect_hash>
+build_perfect_hash(std::span<const std::string_view> names,
+                   std::uint32_t max_seed = 1U << 20) {
+  const auto count = names.size();
+  perfect_hash result{.seeds = std::vector<std::uint32_t>(count, 0),
+                      .slots = std::vector<std::size_t>(count, 0)};
+  std::vector<std::uint64_t> hashes(count);
+  std::vector<std::vector<std::size_t>> buckets(count);
+  for (std::size_t i = 0; i < count; ++i) {
+    hashes[i] = name_hash(names[i]);
+    buckets[hash_bucket(hashes[i], count)].push_back(i);
+  }
+  std::vector<std::size_t> order(count);
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  rg::stable_sort(order, std::greater{},
+                  [&](std::size_t b) { return buckets[b].size(); });
+
+  std::vector<bool> taken(count, false);
+  std::vector<std::size_t> candidate;
+  for (const auto bucket : order) {
+    auto const &keys = buckets[bucket];
+    std::uint32_t seed = 0;
+    for (;; ++seed) {
+      if (seed == max_seed) {
+        return std::nullopt;
+      }
+      candidate.clear();
+      for (const auto key : keys) {
+        const auto slot = hash_slot(hashes[key], seed, count);
+        if (taken[slot] || rg::find(candidate, slot) != candidate.end()) {
+          break;
+        }
+        candidate.push_back(slot);
+      }
+      if (candidate.size() == keys.size()) {
+        break;
+      }
+    }
+    result.seeds[bucket] = seed;
+    for (std::size_t i = 0; i < keys.size(); ++i) {
+      taken[candidate[i]] = true;
+      result.slots[keys[i]] = candidate[i];
+    }
+  }
+  return result;
+}
+
+using pool_allocator = rapidjson::MemoryPoolAllocator<>;
+using buffered_document =
+    rapidjson::GenericDocument<rapidjson::UTF8<>, pool_allocator,
+                               pool_allocator>;
+
+constexpr std::size_t min_buffer_size = 4 * 1024;
+constexpr std::size_t default_chunk_size = 64 * 1024;
+constexpr std::size_t parse_stack_capacity = 1024;
+constexpr auto parse_flags =
+    rapidjson::kParseCommentsFlag | rapidjson::kParseTrailingCommasFlag;
+
+inline parse_buffers &thread_parse_buffers() {
+  thread_local parse_buffers buffers;
+  return buffers;
+}
+
+inline void grow_buffer(std::vector<char> &buffer, std::size_t size) {
+  if (buffer.size() < size) {
+    buffer.resize(size);
+  }
+}
+
+/// Reads the whole file into text, reusing its capacity
+inline result<void> read_file(std::filesystem::path const &path,
+                              std::string &text) {
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  if (!file) {
+    return error{.code = errc::file_open_failed, .detail = path.string()};
+  }
+  const auto size = file.tellg();
+  if (size < 0) {
+    return error{.code = errc::file_read_failed, .detail = path.string()};
+  }
+  text.resize(static_cast<std::size_t>(size));
+  file.seekg(0);
+  if (!file.read(text.data(), static_cast<std::streamsize>(text.size()))) {
+    return error{.code = errc::file_read_failed, .detail = path.string()};
+  }
+  return {};
+}
+
+/// A file to read with read_files(), and once read its contents or the
+/// error of read_file()
+struct file_read {
+  explicit file_read(std::filesystem::path file) : path(std::move(file)) {}
+
+  std::filesystem::path path;
+  std::string text;
+  result<void> status;
+};
+
+/// Contents of files already read, used by load_index() in place of
+/// reading them again
+using preloaded_files = std::span<file_read const>;
+
+/// Reads path into text from preloaded if it holds it, else from disk
+inline result<void> read_file(std::filesystem::path const &path,
+                              std::string &text, preloaded_files preloaded) {
+  const auto file = rg::find(preloaded, path, &file_read::path);
+  if (file == preloaded.end()) {
+    return read_file(path, text);
+  }
+  if (file->status) {
+    text.assign(file->text);
+  }
+  return file->status;
+}
+
+/// Reads every file on a thread of its own, the last on the calling thread
+inline void read_files_threaded(std::span<file_read> files) {
+  if (files.empty()) {
+    return;
+  }
+  const auto read = [](file_read &file) {
+    file.status = read_file(file.path, file.text);
+  };
+  std::vector<std::jthread> readers;
+  readers.reserve(files.size() - 1);
+  for (auto &file : files.first(files.size() - 1)) {
+    readers.emplace_back(read, std::ref(file));
+  }
+  read(files.back());
+}
 
+#if defined(ER_HWINFO_HAS_IO_URING)
 /**
- * @brief Query hardware information for the current device.
- *
- * Reads device type and revision from the Linux device tree, then looks up
- * GPIO pin definitions from the hardware database. Uses intelligent revision
- * matching to find compatible pin definitions.
- *
- * @param dt_base_path Path to the device tree base directory
- * @param hwdb_path Path to the hardware database JSON file
- * @param hwdb_schema_path Path to the JSON schema for validation
- *
- * @return std::optional<info> containing device info and pins, or std::nullopt
- *         if the device tree is missing or invalid
- *
- * @throws std::runtime_error if JSON files cannot be opened or parsed
- * @throws std::runtime_error if JSON fails schema validation
- *
- * @note Returns info with empty pins if device type is not in the database
- *       or no compatible revision is found (different major version)
- *
- * @par Revision Matching Algorithm:
- * 1. Exact match: use if device revision matches a database entry exactly
- * 2. Forward match: use first database revision >= device with same major
- * 3. Backward search: use highest database revision with same major
- * 4. No match: return empty pins if no same-major revision exists
- *
- * @par Example:
- * @code
- * auto info = er::hwinfo::get();
- * if (info) {
- *     std::cout << "Type: " << info->dev.hw_type << "\n";
- *     for (const auto& pin : info->pins) {
- *         std::cout << pin.name << ": GPIO " << pin.number << "\n";
- *     }
- * }
- * @endcode
+ * Minimal io_uring instance that submits a batch of reads and waits for
+ * all of them, set up through the raw system calls so that liburing is
+ * not needed. valid() is false if the kernel lacks io_uring or it is
+ * disabled, e.g. by a seccomp filter.
  */
-inline std::optional<info>
-get(std::filesystem::path const &dt_base_path = "/proc/device-tree",
-    std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
-    std::filesystem::path const &hwdb_schema_path =
-        "/etc/er-hwinfo/hwdb-schema.json") {
-  auto device_opt = impl::get_device(dt_base_path);
-  if (!device_opt) {
-    return std::nullopt;
+class uring {
+public:
+  /// A read of size bytes from the start of fd into data
+  struct read_request {
+    int fd;
+    char *data;
+    std::uint32_t size;
+    std::int32_t result = 0; ///< Bytes read, or -errno
+  };
+
+  explicit uring(unsigned entries) {
+    io_uring_params params{};
+    fd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (fd_ < 0) {
+      return;
+    }
+    sq_off_ = params.sq_off;
+    cq_off_ = params.cq_off;
+    sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_size_ =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap) {
+      sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+    }
+    sq_ = map(sq_size_, IORING_OFF_SQ_RING);
+    cq_ = single_mmap ? sq_ : map(cq_size_, IORING_OFF_CQ_RING);
+    sqes_ = static_cast<io_uring_sqe *>(map(sqes_size_, IORING_OFF_SQES));
+    entries_ = params.sq_entries;
   }
-  constexpr auto flags =
-      rapidjson::kParseCommentsFlag | rapidjson::kParseTrailingCommasFlag;
-  rapidjson::Document hwdb =
-      impl::read_and_validate_json<flags>(hwdb_path, hwdb_schema_path);
-
-  auto const type_iter = hwdb.FindMember(device_opt->hw_type.c_str());
-  if (type_iter == hwdb.MemberEnd()) {
-    return info{.dev = *device_opt, .pins = {}};
-  }
-  const auto &type_entry = type_iter->value;
-  const auto hwrevision_iter =
-      impl::resolve_revision(device_opt->hw_revision, type_entry);
-  if (hwrevision_iter == type_entry.GetObject().MemberEnd()) {
-    return info{.dev = *device_opt, .pins = {}};
-  }
-  auto &hwrev_entry = hwrevision_iter->value;
-  auto const &pins = hwrev_entry["pins"].GetObject();
-  auto &&pinrange =
-      impl::rg::subrange(pins.MemberBegin(), pins.MemberEnd()) |
-      impl::rgv::transform([&](auto const &m) {
-        return pin{.name = m.name.GetString(),
-                   .number = m.value["value"].GetUint(),
-                   .description = m.value["description"].GetString()};
-      });
 
-  return info{.dev = *device_opt,
-              .pins = {impl::rg::begin(pinrange), impl::rg::end(pinrange)}};
-}
+  uring(uring const &) = delete;
+  uring &operator=(uring const &) = delete;
 
-} // namespace hwinfo
-} // namespace er
\ No newline at end of file
+  ~uring() {
+    unmap(sqes_, sqes_size_);
+    if (cq_ != sq_) {
+      unmap(cq_, cq_size_);
+    }
+    unmap(sq_, sq_size_);
+    if (fd_ >= 0) {
+      ::close(fd_);
+    }
+  }
+
+  bool valid() const noexcept {
+    return fd_ >= 0 && sq_ != MAP_FAILED && cq_ != MAP_FAILED &&
+           sqes_ != MAP_FAILED;
+  }
+
+  /// Submits the requests and waits until all completed. Requests the
+  /// ring could not submit keep a result of 0.
+  void read_all(std::span<read_request> requests) {
+    const auto count =
+        static_cast<unsigned>(std::min<std::size_t>(requests.size(), entries_));
+    auto &sq_tail = word(sq_, sq_off_.tail);
+    const auto sq_mask = word(sq_, sq_off_.ring_mask);
+    auto *const sq_array = &word(sq_, sq_off_.array);
+    auto tail = sq_tail;
+    for (unsigned i = 0; i < count; ++i, ++tail) {
+      const auto slot = tail & sq_mask;
+      io_uring_sqe &sqe = sqes_[slot];
+      std::memset(&sqe, 0, sizeof(sqe));
+      sqe.opcode = IORING_OP_READ;
+      sqe.fd = requests[i].fd;
+      sqe.addr = reinterpret_cast<std::uintptr_t>(requests[i].data);
+      sqe.len = requests[i].size;
+      sqe.user_data = i;
+      sq_array[slot] = slot;
+    }
+    std::atomic_ref(sq_tail).store(tail, std::memory_order_release);
+
+    auto &cq_head = word(cq_, cq_off_.head);
+    auto &cq_tail = word(cq_, cq_off_.tail);
+    const auto cq_mask = word(cq_, cq_off_.ring_mask);
+    auto *const cqes = reinterpret_cast<io_uring_cqe *>(
+        static_cast<char *>(cq_) + cq_off_.cqes);
+    unsigned submitted = 0;
+    unsigned completed = 0;
+    while (completed < submitted || submitted < count) {
+      const auto entered = ::syscall(__NR_io_uring_enter, fd_,
+                                     count - submitted, 1,
+                                     IORING_ENTER_GETEVENTS, nullptr, 0);
+      if (entered < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY ||
+            completed < submitted) {
+          continue;
+        }
+        return;
+      }
+      submitted += static_cast<unsigned>(entered);
+      auto head = cq_head;
+      const auto end = std::atomic_ref(cq_tail).load(std::memory_order_acquire);
+      for (; head != end; ++head, ++completed) {
+        auto const &cqe = cqes[head & cq_mask];
+        requests[cqe.user_data].result = cqe.res;
+      }
+      std::atomic_ref(cq_head).store(head, std::memory_order_release);
+    }
+  }
+
+private:
+  void *map(std::size_t size, off_t offset) const noexcept {
+    return ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, fd_, offset);
+  }
+
+  static void unmap(void *ring, std::size_t size) noexcept {
+    if (ring != MAP_FAILED) {
+      ::munmap(ring, size);
+    }
+  }
+
+  static unsigned &word(void *ring, std::uint32_t offset) noexcept {
+    return *reinterpret_cast<unsigned *>(static_cast<char *>(ring) + offset);
+  }
+
+  int fd_ = -1;
+  unsigned entries_ = 0;
+  io_sqring_offsets sq_off_{};
+  io_cqring_offsets cq_off_{};
+  std::size_t sq_size_ = 0;
+  std::size_t cq_size_ = 0;
+  std::size_t sqes_size_ = 0;
+  void *sq_ = MAP_FAILED;
+  void *cq_ = MAP_FAILED;
+  io_uring_sqe *sqes_ = static_cast<io_uring_sqe *>(MAP_FAILED);
+};
+
+/// Reads the files with one io_uring submission, so that the reads wait
+/// on the disk concurrently
+/// @return false, having read nothing, if io_uring is not available
+inline bool read_files_uring(std::span<file_read> files) {
+  uring ring(static_cast<unsigned>(files.size()));
+  if (!ring.valid()) {
+    return false;
+  }
+  struct descriptor {
+    int fd = -1;
+    ~descriptor() {
+      if (fd >= 0) {
+        ::close(fd);
+      }
+    }
+  };
+  std::vector<descriptor> fds(files.size());
+  std::vector<uring::read_request> requests;
+  std::vector<file_read *> requested;
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    auto &file = files[i];
+    fds[i].fd = ::open(file.path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat info{};
+    if (fds[i].fd < 0 || ::fstat(fds[i].fd, &info) != 0) {
+      file.status =
+          error{.code = errc::file_open_failed, .detail = file.path.string()};
+      continue;
+    }
+    file.text.resize(static_cast<std::size_t>(info.st_size));
+    requests.push_back(uring::read_request{
+        .fd = fds[i].fd,
+        .data = file.text.data(),
+        .size = static_cast<std::uint32_t>(std::min<std::size_t>(
+            file.text.size(), std::numeric_limits<std::int32_t>::max()))});
+    requested.push_back(&file);
+  }
+  ring.read_all(requests);
+
+  // Finish reads the ring left short, failed or, on kernels before 5.6
+  // lacking IORING_OP_READ, rejected
+  for (std::size_t i = 0; i < requests.size(); ++i) {
+    auto &file = *requested[i];
+    auto done = static_cast<std::size_t>(std::max(requests[i].result, 0));
+    while (done < file.text.size()) {
+      const auto read = ::pread(requests[i].fd, file.text.data() + done,
+                                file.text.size() - done,
+                                static_cast<off_t>(done));
+      if (read < 0 && errno == EINTR) {
+        continue;
+      }
+      if (read < 0) {
+        file.status = error{.code = errc::file_read_failed,
+                            .detail = file.path.string()};
+      }
+      if (read <= 0) {
+        break;
+      }
+      done += static_cast<std::size_t>(read);
+    }
+    file.text.resize(done);
+  }
+  return true;
+}
+#endif
+
+/// Reads the files concurrently, with io_uring where the kernel offers it
+/// and a thread per file otherwise, so that reading them all takes about
+/// as long as the slowest read rather than the sum of the reads
+inline void read_files(std::span<file_read> files) {
+#if defined(ER_HWINFO_HAS_IO_URING)
+  if (read_files_uring(files)) {
+    return;
+  }
+#endif
+  read_files_threaded(files);
+}
+
+/// Device tree properties identifying the device, in the order
+/// parse_device() expects their contents: type, revision major, minor
+/// and patch
+inline std::array<file_read, 4>
+device_properties(std::filesystem::path const &dt_base_path) {
+  const auto er_base_path = dt_base_path / "effective-range,hardware";
+  return {file_read(er_base_path / "effective-range,type"),
+          file_read(er_base_path / "effective-range,revision-major"),
+          file_read(er_base_path / "effective-range,revision-minor"),
+          file_read(er_base_path / "effective-range,revision-patch")};
+}
+
+/// The device described by the device_properties() read from a device
+/// tree, or std::nullopt if any of them is missing or invalid
+inline std::optional<device>
+parse_device(std::span<file_read const, 4> properties) {
+  if (rg::any_of(properties, [](auto const &p) { return !p.status; })) {
+    return std::nullopt;
+  }
+  // The type is the first word of its property, delimited by whitespace
+  // or by the NUL that terminates device tree strings
+  const auto is_delimiter = [](char c) {
+    return c == ' ' || (c >= '\t' && c <= '\r') || c == '\0';
+  };
+  std::string_view type = properties[0].text;
+  type.remove_prefix(static_cast<std::size_t>(
+      rg::find_if_not(type, is_delimiter) - type.begin()));
+  type = type.substr(0, static_cast<std::size_t>(
+                            rg::find_if(type, is_delimiter) - type.begin()));
+  device dev;
+  if (type.empty() || !assign_text(dev.hw_type, type)) {
+    return std::nullopt;
+  }
+  // Revisions are big-endian 32-bit cells
+  std::array<std::uint32_t, 3> cells{};
+  for (std::size_t i = 0; i < cells.size(); ++i) {
+    auto const &text = properties[i + 1].text;
+    if (text.size() < sizeof(cells[i])) {
+      return std::nullopt;
+    }
+    std::memcpy(&cells[i], text.data(), sizeof(cells[i]));
+    cells[i] = ntohl(cells[i]);
+  }
+  dev.hw_revision = revision{
+      .major = cells[0],
+      .minor = cells[1],
+      .patch = cells[2],
+  };
+  return dev;
+}
+
+inline std::optional<device>
+get_device(std::filesystem::path const &dt_base_path) {
+  auto properties = device_properties(dt_base_path);
+  for (auto &property : properties) {
+    property.status = read_file(property.path, property.text);
+  }
+  return parse_device(properties);
+}
+
+inline error parse_error(rapidjson::ParseErrorCode code, std::size_t offset) {
+  return error{.code = errc::parse_failed,
+               .offset = offset,
+               .detail = rapidjson::GetParseError_En(code)};
+}
+
+template <auto Flags>
+result<void> parse_document(buffered_document &doc, std::string const &text) {
+  if (doc.Parse<Flags>(text.data(), text.size()).HasParseError()) {
+    return parse_error(doc.GetParseError(), doc.GetErrorOffset());
+  }
+  return {};
+}
+
+template <typename... Args>
+std::string invalid_schema_pointer(
+    rapidjson::GenericSchemaValidator<Args...> const &validator) {
+  rapidjson::StringBuffer sb;
+  validator.GetInvalidSchemaPointer().StringifyUriFragment(sb);
+  return sb.GetString();
+}
+
+/// Number of code points of UTF-8 text, as counted by maxLength
+constexpr std::size_t code_points(std::string_view text) noexcept {
+  return static_cast<std::size_t>(rg::count_if(text, [](char c) {
+    return (static_cast<unsigned char>(c) & 0xc0U) != 0x80U;
+  }));
+}
+
+/// Matches ^[0-9]+\.[0-9]+\.[0-9]+$
+constexpr bool is_revision_key(std::string_view key) noexcept {
+  int components = 0;
+  std::size_t digits = 0;
+  for (const char c : key) {
+    if (c >= '0' && c <= '9') {
+      ++digits;
+    } else if (c == '.' && digits > 0 && components < 2) {
+      ++components;
+      digits = 0;
+    } else {
+      return false;
+    }
+  }
+  return components == 2 && digits > 0;
+}
+
+/**
+ * SAX filter enforcing the hwdb schema described by Schema (see
+ * generated::hwdb_schema) in a single pass, without allocating. The shape
+ * of the document is fixed, so instead of interpreting the schema it only
+ * tracks which level of the document the next value belongs to. Events of
+ * a valid document are forwarded to the output handler, if any.
+ */
+template <typename Schema, typename Handler = rapidjson::BaseReaderHandler<>>
+class compiled_validator {
+public:
+  using Ch = char;
+
+  compiled_validator() = default;
+  explicit compiled_validator(Handler &out) noexcept : out_(&out) {}
+
+  bool IsValid() const noexcept { return keyword_ == nullptr; }
+
+  /// Schema location of the violated constraint, e.g. "#/propertyNames"
+  char const *invalid_schema_pointer() const noexcept { return pointer_; }
+
+  /// Violated schema keyword, e.g. "maxLength"
+  char const *invalid_keyword() const noexcept { return keyword_; }
+
+  bool Null() {
+    return scalar() && forward([](Handler &h) { return h.Null(); });
+  }
+  bool Bool(bool b) {
+    return scalar() && forward([&](Handler &h) { return h.Bool(b); });
+  }
+  bool Int(int i) {
+    return integer(i) && forward([&](Handler &h) { return h.Int(i); });
+  }
+  bool Uint(unsigned u) {
+    return integer(u) && forward([&](Handler &h) { return h.Uint(u); });
+  }
+  bool Int64(std::int64_t i) {
+    return integer(i) && forward([&](Handler &h) { return h.Int64(i); });
+  }
+  bool Uint64(std::uint64_t u) {
+    return integer(u) && forward([&](Handler &h) { return h.Uint64(u); });
+  }
+  bool Double(double d) {
+    return scalar() && forward([&](Handler &h) { return h.Double(d); });
+  }
+  bool RawNumber(Ch const *str, rapidjson::SizeType length, bool copy) {
+    return String(str, length, copy);
+  }
+
+  bool String(Ch const *str, rapidjson::SizeType length, bool copy) {
+    if (!IsValid()) {
+      return false;
+    }
+    if (!unconstrained() && !string({str, length})) {
+      return false;
+    }
+    return forward([&](Handler &h) { return h.String(str, length, copy); });
+  }
+
+  bool StartObject() {
+    if (!IsValid()) {
+      return false;
+    }
+    if (unconstrained()) {
+      ++skip_depth_;
+    } else if (!is_object(next_)) {
+      return fail(pointer(next_), "type");
+    } else {
+      if (next_ == node::revision) {
+        has_pins_ = false;
+      } else if (next_ == node::pin) {
+        has_description_ = false;
+        has_value_ = false;
+      }
+      container_ = next_;
+    }
+    return forward([](Handler &h) { return h.StartObject(); });
+  }
+
+  bool Key(Ch const *str, rapidjson::SizeType length, bool copy) {
+    if (!IsValid()) {
+      return false;
+    }
+    if (skip_depth_ == 0 && !key({str, length})) {
+      return false;
+    }
+    return forward([&](Handler &h) { return h.Key(str, length, copy); });
+  }
+
+  bool EndObject(rapidjson::SizeType members) {
+    if (!IsValid()) {
+      return false;
+    }
+    if (skip_depth_ > 0) {
+      --skip_depth_;
+    } else {
+      if (container_ == node::revision && Schema::pins_required &&
+          !has_pins_) {
+        return fail(pointer(container_), "required");
+      }
+      if (container_ == node::pin &&
+          ((Schema::description_required && !has_description_) ||
+           (Schema::value_required && !has_value_))) {
+        return fail(pointer(container_), "required");
+      }
+      container_ = parent(container_);
+    }
+    return forward([&](Handler &h) { return h.EndObject(members); });
+  }
+
+  bool StartArray() {
+    if (!IsValid()) {
+      return false;
+    }
+    if (unconstrained()) {
+      ++skip_depth_;
+    } else if (next_ == node::remove) {
+      container_ = node::remove;
+      next_ = node::removed_pin;
+    } else {
+      return fail(pointer(next_), "type");
+    }
+    return forward([](Handler &h) { return h.StartArray(); });
+  }
+
+  bool EndArray(rapidjson::SizeType elements) {
+    if (!IsValid()) {
+      return false;
+    }
+    if (skip_depth_ > 0) {
+      --skip_depth_;
+    } else {
+      container_ = parent(container_);
+    }
+    return forward([&](Handler &h) { return h.EndArray(elements); });
+  }
+
+private:
+  /// Levels of the document, each with its own subschema
+  enum class node : std::uint8_t {
+    document,
+    types,
+    revisions,
+    revision,
+    pins,
+    pin,
+    description,
+    value,
+    base,
+    remove,
+    removed_pin,
+    any, ///< value of an additional property, not constrained
+  };
+
+  static constexpr node parent(node n) noexcept {
+    switch (n) {
+    case node::types:
+      return node::document;
+    case node::base:
+    case node::remove:
+      return node::revision;
+    default:
+      return static_cast<node>(static_cast<int>(n) - 1);
+    }
+  }
+
+  static constexpr bool is_object(node n) noexcept {
+    return n <= node::pin || n == node::any;
+  }
+
+  static constexpr char const *pointer(node n) noexcept {
+    switch (n) {
+    case node::revisions:
+      return "#/additionalProperties";
+    case node::revision:
+      return "#/additionalProperties/additionalProperties";
+    case node::pins:
+      return "#/additionalProperties/additionalProperties/properties/pins";
+    case node::pin:
+      return "#/additionalProperties/additionalProperties/properties/pins"
+             "/additionalProperties";
+    case node::description:
+      return "#/additionalProperties/additionalProperties/properties/pins"
+             "/additionalProperties/properties/description";
+    case node::value:
+      return "#/additionalProperties/additionalProperties/properties/pins"
+             "/additionalProperties/properties/value";
+    case node::base:
+      return "#/additionalProperties/additionalProperties/properties/base";
+    case node::remove:
+      return "#/additionalProperties/additionalProperties/properties/remove";
+    case node::removed_pin:
+      return "#/additionalProperties/additionalProperties/properties/remove"
+             "/items";
+    default:
+      return "#";
+    }
+  }
+
+  static constexpr char const *property_names_pointer(node n) noexcept {
+    switch (n) {
+    case node::revisions:
+      return "#/additionalProperties/propertyNames";
+    case node::pins:
+      return "#/additionalProperties/additionalProperties/properties/pins"
+             "/propertyNames";
+    default:
+      return "#/propertyNames";
+    }
+  }
+
+  bool unconstrained() const noexcept {
+    return skip_depth_ > 0 || next_ == node::any;
+  }
+
+  bool key(std::string_view name) {
+    switch (container_) {
+    case node::types:
+      if (code_points(name) > Schema::type_name_max_length) {
+        return fail(property_names_pointer(container_), "maxLength");
+      }
+      next_ = node::revisions;
+      return true;
+    case node::revisions:
+      if (code_points(name) > Schema::revision_key_max_length) {
+        return fail(property_names_pointer(container_), "maxLength");
+      }
+      if (Schema::revision_key_pattern && !is_revision_key(name)) {
+        return fail(property_names_pointer(container_), "pattern");
+      }
+      next_ = node::revision;
+      return true;
+    case node::revision:
+      if (name == "pins") {
+        has_pins_ = true;
+        next_ = node::pins;
+        return true;
+      }
+      if (Schema::revision_base && name == "base") {
+        next_ = node::base;
+        return true;
+      }
+      if (Schema::revision_remove && name == "remove") {
+        next_ = node::remove;
+        return true;
+      }
+      return additional_property(Schema::revision_additional_properties);
+    case node::pins:
+      if (code_points(name) > Schema::pin_name_max_length) {
+        return fail(property_names_pointer(container_), "maxLength");
+      }
+      next_ = node::pin;
+      return true;
+    case node::pin:
+      if (name == "description") {
+        has_description_ = true;
+        next_ = node::description;
+        return true;
+      }
+      if (name == "value") {
+        has_value_ = true;
+        next_ = node::value;
+        return true;
+      }
+      return additional_property(Schema::pin_additional_properties);
+    default:
+      return fail(pointer(container_), "type");
+    }
+  }
+
+  bool string(std::string_view text) {
+    switch (next_) {
+    case node::description:
+      if (code_points(text) > Schema::description_max_length) {
+        return fail(pointer(next_), "maxLength");
+      }
+      return true;
+    case node::base:
+      if (code_points(text) > Schema::base_max_length) {
+        return fail(pointer(next_), "maxLength");
+      }
+      if (Schema::base_pattern && !is_revision_key(text)) {
+        return fail(pointer(next_), "pattern");
+      }
+      return true;
+    case node::removed_pin:
+      if (code_points(text) > Schema::removed_pin_max_length) {
+        return fail(pointer(next_), "maxLength");
+      }
+      return true;
+    default:
+      return fail(pointer(next_), "type");
+    }
+  }
+
+  bool additional_property(bool allowed) {
+    next_ = node::any;
+    return allowed || fail(pointer(container_), "additionalProperties");
+  }
+
+  bool scalar() {
+    if (!IsValid()) {
+      return false;
+    }
+    return unconstrained() || fail(pointer(next_), "type");
+  }
+
+  template <typename Int> bool integer(Int number) {
+    if (!IsValid()) {
+      return false;
+    }
+    if (unconstrained()) {
+      return true;
+    }
+    if (next_ != node::value) {
+      return fail(pointer(next_), "type");
+    }
+    if (std::cmp_less(number, Schema::value_minimum)) {
+      return fail(pointer(next_), "minimum");
+    }
+    if (std::cmp_greater(number, Schema::value_maximum)) {
+      return fail(pointer(next_), "maximum");
+    }
+    return true;
+  }
+
+  bool fail(char const *schema_pointer, char const *keyword) noexcept {
+    pointer_ = schema_pointer;
+    keyword_ = keyword;
+    return false;
+  }
+
+  template <typename Fn> bool forward(Fn &&fn) {
+    return out_ == nullptr || std::forward<Fn>(fn)(*out_);
+  }
+
+  Handler *out_ = nullptr;
+  char const *pointer_ = nullptr;
+  char const *keyword_ = nullptr;
+  std::size_t skip_depth_ = 0;
+  node next_ = node::types;
+  node container_ = node::document;
+  bool has_pins_ = false;
+  bool has_description_ = false;
+  bool has_value_ = false;
+};
+
+template <typename Schema, typename Handler>
+std::string
+invalid_schema_pointer(compiled_validator<Schema, Handler> const &validator) {
+  return validator.invalid_schema_pointer();
+}
+
+/**
+ * Revisions of one hardware type. The packed revisions are kept apart from
+ * their pins in one dense sorted array, so that resolving a revision only
+ * touches contiguous keys.
+ */
+struct revision_list {
+  std::vector<revision_key> keys; ///< Packed revisions, sorted ascending
+  /// Pins of the revision at the same index; revisions with identical pins
+  /// share one map
+  std::vector<std::shared_ptr<const pin_map>> pins;
+
+  std::size_t size() const noexcept { return keys.size(); }
+
+  revision revision_at(std::size_t i) const noexcept {
+    return unpack_revision(keys[i]);
+  }
+
+  /// Index of the revision selected for requested as described on get(),
+  /// or size() if none matches
+  std::size_t select(revision requested) const noexcept {
+    const auto key = pack_request(requested);
+    return key ? select_revision_key(keys, *key) : size();
+  }
+};
+
+/// Transparent string hash, so that the index is searchable by string_view
+struct string_hash {
+  using is_transparent = void;
+  std::size_t operator()(std::string_view name) const noexcept {
+    return std::hash<std::string_view>{}(name);
+  }
+};
+
+/// Hardware types by name
+using type_index = std::unordered_map<std::string, revision_list,
+                                      string_hash, std::equal_to<>>;
+
+/// Content hashes of the text a database was loaded from, for reloading
+/// only what changed
+struct source_hashes {
+  /// Hash of the schema file, none for the built-in schema
+  std::optional<std::uint64_t> schema;
+  /// Hash of the JSON text of each type, see type_slice::hash
+  std::unordered_map<std::string, std::uint64_t, string_hash,
+                     std::equal_to<>>
+      types;
+};
+
+/// Bounded, thread-safe memo of the pin sets resolved for devices. Hits
+/// take a shared lock only. Once full, the device cached first is evicted.
+/// Copies start out empty, since they may outlive the cached results'
+/// database.
+class pin_cache {
+public:
+  static constexpr std::size_t default_capacity = 64;
+
+  explicit pin_cache(std::size_t capacity = default_capacity) noexcept
+      : capacity_(std::max<std::size_t>(capacity, 1)) {}
+  pin_cache(pin_cache const &other) noexcept : pin_cache(other.capacity_) {}
+  pin_cache &operator=(pin_cache const &other) {
+    if (this != &other) {
+      const std::lock_guard lock(mutex_);
+      entries_.clear();
+      order_.clear();
+      next_ = 0;
+      capacity_ = other.capacity_;
+      hits_ = 0;
+      misses_ = 0;
+    }
+    return *this;
+  }
+
+  /// The pins cached for dev, else the result of resolve(), cached
+  template <typename Resolve>
+  std::shared_ptr<const pin_set> get(device const &dev,
+                                     Resolve const &resolve) {
+    const key_view key{.hw_type = dev.hw_type, .hw_revision = dev.hw_revision};
+    {
+      const std::shared_lock lock(mutex_);
+      if (const auto iter = entries_.find(key); iter != entries_.end()) {
+        hits_.fetch_add(1, std::memory_order_relaxed);
+        return iter->second;
+      }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    std::shared_ptr<const pin_set> pins = resolve();
+    const std::lock_guard lock(mutex_);
+    entry_key owned{.hw_type = std::string(key.hw_type),
+                    .hw_revision = key.hw_revision};
+    const auto [iter, inserted] = entries_.try_emplace(owned, pins);
+    if (!inserted) {
+      return iter->second; // resolved concurrently
+    }
+    if (order_.size() < capacity_) {
+      order_.push_back(std::move(owned));
+    } else {
+      entries_.erase(order_[next_]);
+      order_[next_] = std::move(owned);
+      next_ = (next_ + 1) % capacity_;
+    }
+    return pins;
+  }
+
+  pin_cache_stats stats() const {
+    const std::shared_lock lock(mutex_);
+    return {.hits = hits_.load(std::memory_order_relaxed),
+            .misses = misses_.load(std::memory_order_relaxed),
+            .size = entries_.size(),
+            .capacity = capacity_};
+  }
+
+private:
+  struct key_view {
+    std::string_view hw_type;
+    revision hw_revision;
+  };
+  struct entry_key {
+    std::string hw_type;
+    revision hw_revision;
+    operator key_view() const noexcept { return {hw_type, hw_revision}; }
+  };
+  struct key_hash {
+    using is_transparent = void;
+    std::size_t operator()(key_view key) const noexcept {
+      auto hash = name_hash(key.hw_type);
+      for (const auto part : {key.hw_revision.major, key.hw_revision.minor,
+                              key.hw_revision.patch}) {
+        hash = mix_bits(hash ^ part);
+      }
+      return hash;
+    }
+  };
+  struct key_equal {
+    using is_transparent = void;
+    bool operator()(key_view a, key_view b) const noexcept {
+      return a.hw_type == b.hw_type && a.hw_revision == b.hw_revision;
+    }
+  };
+
+  mutable std::shared_mutex mutex_;
+  std::unordered_map<entry_key, std::shared_ptr<const pin_set>, key_hash,
+                     key_equal>
+      entries_;
+  std::vector<entry_key> order_; ///< Keys in insertion order, a ring
+  std::size_t next_ = 0;         ///< Slot of order_ to evict next
+  std::size_t capacity_;
+  std::atomic<std::uint64_t> hits_{0};
+  std::atomic<std::uint64_t> misses_{0};
+};
+
+/// Content hash of a pin map, consistent with its operator==
+inline std::uint64_t pins_hash(pin_map const &pins) noexcept {
+  std::uint64_t hash = pins.size();
+  for (std::size_t i = 0; i < pins.size(); ++i) {
+    hash = mix_bits(hash ^ name_hash(pins.name(i)));
+    hash = mix_bits(hash ^ pins.number(i));
+    hash = mix_bits(hash ^ name_hash(pins.description(i)));
+  }
+  return hash;
+}
+
+/**
+ * SAX handler building the lookup index straight from the events of a hwdb
+ * document, so that no DOM is needed. Revisions of a type are sorted once
+ * the type is complete; if several keys denote the same revision (e.g.
+ * "1.0.0" and "01.0.0"), or a type name repeats, the first one wins. Values
+ * the index has no use for, such as additional properties allowed by a
+ * custom schema, are skipped. A revision with a base inherits the pins of
+ * that revision of the same type, less its removed pins, with its own pins
+ * added or replacing inherited ones; bases are resolved once the type is
+ * complete. Revisions with identical pins, of any type, share one pin_map,
+ * and descriptions are interned across the database.
+ */
+class index_builder
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, index_builder> {
+public:
+  bool Default() { return true; }
+  bool Int(int i) { return number(i); }
+  bool Uint(unsigned u) { return number(u); }
+  bool Int64(std::int64_t i) { return number(i); }
+  bool Uint64(std::uint64_t u) { return number(u); }
+
+  bool String(Ch const *str, rapidjson::SizeType length, bool) {
+    const std::string_view text(str, length);
+    if (in_field(pin_depth, field::description)) {
+      return assign(pin_.description, text);
+    }
+    if (in_field(revision_depth, field::base)) {
+      return set_base(text);
+    }
+    if (in_removed_ && skip_depth_ == 0) {
+      entries_.back().removed.emplace_back(text);
+    }
+    return true;
+  }
+
+  bool StartObject() {
+    if (skip_depth_ > 0 || depth_ == pin_depth || !next_tracked_) {
+      ++skip_depth_;
+      return true;
+    }
+    switch (++depth_) {
+    case type_depth: {
+      auto [iter, inserted] = index_.try_emplace(key_);
+      if (!inserted) {
+        --depth_;
+        ++skip_depth_;
+        return true;
+      }
+      type_name_ = iter->first;
+      revisions_ = &iter->second;
+      entries_.clear();
+      break;
+    }
+    case revision_depth:
+      entries_.emplace_back().key = rev_;
+      break;
+    case pin_depth:
+      pin_ = pin{};
+      field_ = field::none;
+      return assign(pin_.name, key_);
+    default:
+      break;
+    }
+    return true;
+  }
+
+  /// Stops the parse with failure() set if a revision key is not
+  /// major.minor.patch or out of the packed range
+  bool Key(Ch const *str, rapidjson::SizeType length, bool) {
+    if (skip_depth_ > 0) {
+      return true;
+    }
+    const std::string_view name(str, length);
+    next_tracked_ = true;
+    switch (depth_) {
+    case revision_depth:
+      next_tracked_ = name == "pins";
+      field_ = name == "base"     ? field::base
+               : name == "remove" ? field::remove
+                                  : field::none;
+      break;
+    case type_depth: {
+      const auto rev = try_extract_revision(name);
+      if (!rev) {
+        failure_ = rev.error();
+        return false;
+      }
+      const auto key = pack_revision(*rev);
+      if (!key) {
+        failure_ = error{.code = errc::revision_out_of_range,
+                         .detail = std::string(name)};
+        return false;
+      }
+      rev_ = *key;
+      break;
+    }
+    case pin_depth:
+      field_ = name == "description" ? field::description
+               : name == "value"     ? field::value
+                                     : field::none;
+      break;
+    case types_depth:
+    case pins_depth:
+      key_.assign(name);
+      break;
+    default:
+      break;
+    }
+    return true;
+  }
+
+  bool EndObject(rapidjson::SizeType) {
+    if (skip_depth_ > 0) {
+      --skip_depth_;
+      return true;
+    }
+    if (depth_ == pin_depth) {
+      pins_.push_back(std::move(pin_));
+    } else if (depth_ == revision_depth) {
+      auto &revision = entries_.back();
+      if (revision.base) {
+        // Resolved by finish_type(), once the base is known
+        revision.pins = std::exchange(pins_, {});
+      } else {
+        revision.map = shared_pins();
+      }
+    } else if (depth_ == type_depth && !finish_type()) {
+      return false;
+    }
+    --depth_;
+    return true;
+  }
+
+  bool StartArray() {
+    if (in_field(revision_depth, field::remove) && !in_removed_) {
+      in_removed_ = true;
+    } else {
+      ++skip_depth_;
+    }
+    return true;
+  }
+
+  bool EndArray(rapidjson::SizeType) {
+    if (skip_depth_ > 0) {
+      --skip_depth_;
+    } else {
+      in_removed_ = false;
+    }
+    return true;
+  }
+
+  /// Why the builder stopped the parse, if it did
+  std::optional<error> const &failure() const noexcept { return failure_; }
+
+  /// The index built from the document
+  type_index finish() && { return std::move(index_); }
+
+private:
+  /// Depths of the objects the index is built from
+  static constexpr int types_depth = 1;
+  static constexpr int type_depth = 2;
+  static constexpr int revision_depth = 3;
+  static constexpr int pins_depth = 4;
+  static constexpr int pin_depth = 5;
+
+  enum class field : std::uint8_t { none, description, value, base, remove };
+
+  /// A revision of the current type
+  struct entry {
+    revision_key key{};
+    std::optional<revision_key> base;  ///< Revision the pins derive from
+    std::vector<pin> pins;             ///< Own pins, until resolved
+    std::vector<std::string> removed; ///< Inherited pins to drop
+    std::shared_ptr<const pin_map> map; ///< Resolved pins
+  };
+
+  /// Sets out to text, stopping the parse if it does not fit
+  template <typename String> bool assign(String &out, std::string_view text) {
+    if (!assign_text(out, text)) {
+      failure_ = error{.code = errc::string_too_long,
+                       .detail = std::string(text)};
+      return false;
+    }
+    return true;
+  }
+
+  bool in_field(int depth, field f) const noexcept {
+    return skip_depth_ == 0 && !in_removed_ && depth_ == depth &&
+           field_ == f;
+  }
+
+  /// Stops the parse if the base is not a valid revision
+  bool set_base(std::string_view text) {
+    const auto rev = try_extract_revision(text);
+    if (!rev) {
+      failure_ = rev.error();
+      return false;
+    }
+    const auto key = pack_revision(*rev);
+    if (!key) {
+      failure_ = error{.code = errc::revision_out_of_range,
+                       .detail = std::string(text)};
+      return false;
+    }
+    entries_.back().base = *key;
+    return true;
+  }
+
+  /// Stops the parse if the GPIO number does not fit pin_map
+  template <typename Int> bool number(Int value) {
+    if (!in_field(pin_depth, field::value) || std::cmp_less(value, 0)) {
+      return true;
+    }
+    if (std::cmp_greater(value, std::numeric_limits<std::uint8_t>::max())) {
+      failure_ = error{.code = errc::gpio_out_of_range,
+                       .detail = std::string(std::string_view(pin_.name))};
+      return false;
+    }
+    pin_.number = static_cast<std::size_t>(value);
+    return true;
+  }
+
+  /// The map of pins_, shared with every earlier revision with the same
+  /// pins
+  std::shared_ptr<const pin_map> shared_pins() {
+    auto pins = std::make_shared<const pin_map>(pins_, descriptions_);
+    pins_.clear();
+    const auto hash = pins_hash(*pins);
+    for (auto [iter, last] = layouts_.equal_range(hash); iter != last;
+         ++iter) {
+      if (*iter->second == *pins) {
+        return iter->second;
+      }
+    }
+    layouts_.emplace(hash, pins);
+    return pins;
+  }
+
+  /// Index of the entry of key, or entries_.size() if there is none
+  std::size_t find_entry(revision_key key) const noexcept {
+    const auto iter = rg::lower_bound(entries_, key, {}, &entry::key);
+    return iter != entries_.end() && iter->key == key
+               ? static_cast<std::size_t>(iter - entries_.begin())
+               : entries_.size();
+  }
+
+  /// Resolves the pins of entries_[i] and of the chain of bases it derives
+  /// from, base first. Stops the parse if a base is unknown or the chain
+  /// is circular.
+  bool resolve(std::size_t i) {
+    std::vector<std::size_t> chain;
+    while (!entries_[i].map) {
+      if (rg::find(chain, i) != chain.end()) {
+        return invalid_base(entries_[i]);
+      }
+      chain.push_back(i);
+      const auto base = find_entry(*entries_[i].base);
+      if (base == entries_.size()) {
+        return invalid_base(entries_[i]);
+      }
+      i = base;
+    }
+    for (const auto derived : chain | rgv::reverse) {
+      auto &revision = entries_[derived];
+      auto const &inherited = *entries_[find_entry(*revision.base)].map;
+      // pin_map keeps the first of duplicate names, so own pins go first
+      pins_ = std::move(revision.pins);
+      for (std::size_t p = 0; p < inherited.size(); ++p) {
+        if (rg::find(revision.removed, inherited.name(p)) ==
+            revision.removed.end()) {
+          pins_.push_back(inherited.at(p));
+        }
+      }
+      revision.map = shared_pins();
+    }
+    return true;
+  }
+
+  bool invalid_base(entry const &revision) {
+    failure_ = error{
+        .code = errc::invalid_base,
+        .detail = fmt::format("{} {}", type_name_,
+                              unpack_revision(revision.key).as_string())};
+    return false;
+  }
+
+  bool finish_type() {
+    rg::stable_sort(entries_, {}, &entry::key);
+    const auto dups = rg::unique(entries_, {}, &entry::key);
+    entries_.erase(dups.begin(), dups.end());
+    for (std::size_t i = 0; i < entries_.size(); ++i) {
+      if (!resolve(i)) {
+        return false;
+      }
+    }
+    revisions_->keys.reserve(entries_.size());
+    revisions_->pins.reserve(entries_.size());
+    for (auto &revision : entries_) {
+      revisions_->keys.push_back(revision.key);
+      revisions_->pins.push_back(std::move(revision.map));
+    }
+    return true;
+  }
+
+  type_index index_;
+  std::string_view type_name_; ///< Name of the current type
+  revision_list *revisions_ = nullptr;
+  /// Revisions of the current type in document order
+  std::vector<entry> entries_;
+  std::vector<pin> pins_; ///< Pins of the current revision
+  /// Distinct pin maps by pins_hash()
+  std::unordered_multimap<std::uint64_t, std::shared_ptr<const pin_map>>
+      layouts_;
+  std::shared_ptr<description_pool> descriptions_ =
+      std::make_shared<description_pool>();
+  std::string key_;     ///< Type or pin name of the next value
+  revision_key rev_{}; ///< Revision of the next value
+  pin pin_{};
+  field field_ = field::none;
+  std::optional<error> failure_;
+  int depth_ = 0;
+  std::size_t skip_depth_ = 0;
+  bool next_tracked_ = true;
+  bool in_removed_ = false; ///< Inside the remove array of a revision
+};
+
+using json_reader = rapidjson::GenericReader<rapidjson::UTF8<>,
+                                             rapidjson::UTF8<>, pool_allocator>;
+
+/// Parses stream, passing the events through validator into builder. A
+/// failure of the builder takes precedence, since the validator regards the
+/// builder stopping the parse as a violation.
+template <auto Flags, typename Stream, typename Validator>
+result<void> parse_validated(Stream &stream, Validator &validator,
+                             index_builder const &builder,
+                             json_reader &reader) {
+  reader.template Parse<Flags>(stream, validator);
+  if (builder.failure()) {
+    return *builder.failure();
+  }
+  if (!validator.IsValid()) {
+    return error{.code = errc::schema_violation,
+                 .offset = reader.GetErrorOffset(),
+                 .detail = invalid_schema_pointer(validator)};
+  }
+  if (reader.HasParseError()) {
+    return parse_error(reader.GetParseErrorCode(), reader.GetErrorOffset());
+  }
+  return {};
+}
+
+/// Whether text starts with the magic number of a zstd frame
+constexpr bool is_zstd_frame(std::string_view text) noexcept {
+  return text.starts_with("\x28\xb5\x2f\xfd");
+}
+
+#if defined(ER_HWINFO_ZSTD)
+/**
+ * RapidJSON input stream over zstd-compressed text. The text is
+ * decompressed into window one chunk at a time as the reader consumes it,
+ * so the decompressed document is never held in full. A corrupt or
+ * truncated frame ends the stream early with failure() set.
+ */
+class zstd_stream {
+public:
+  using Ch = char;
+
+  zstd_stream(std::string_view compressed, std::vector<char> &window)
+      : context_(ZSTD_createDCtx()),
+        in_{.src = compressed.data(), .size = compressed.size(), .pos = 0},
+        window_(window) {
+    grow_buffer(window_, ZSTD_DStreamOutSize());
+    if (!context_) {
+      failure_ = "out of memory";
+      return;
+    }
+    fill();
+  }
+
+  Ch Peek() const noexcept { return pos_ < size_ ? window_[pos_] : '\0'; }
+
+  Ch Take() {
+    if (pos_ == size_) {
+      return '\0';
+    }
+    const auto c = window_[pos_++];
+    ++consumed_;
+    if (pos_ == size_) {
+      fill();
+    }
+    return c;
+  }
+
+  std::size_t Tell() const noexcept { return consumed_; }
+
+  // Output side of the stream concept, only used to parse in situ
+  Ch *PutBegin() noexcept { return nullptr; }
+  void Put(Ch) noexcept {}
+  void Flush() noexcept {}
+  std::size_t PutEnd(Ch *) noexcept { return 0; }
+
+  /// zstd's reason the stream ended early, if it did
+  char const *failure() const noexcept { return failure_; }
+
+private:
+  /// Decompresses the next chunk into the window
+  void fill() {
+    pos_ = 0;
+    size_ = 0;
+    while (size_ == 0 && (in_.pos < in_.size || !frame_done_)) {
+      ZSTD_outBuffer out{.dst = window_.data(), .size = window_.size(),
+                         .pos = 0};
+      const auto hint = ZSTD_decompressStream(context_.get(), &out, &in_);
+      if (ZSTD_isError(hint)) {
+        failure_ = ZSTD_getErrorName(hint);
+        return;
+      }
+      size_ = out.pos;
+      frame_done_ = hint == 0;
+      if (size_ == 0 && in_.pos == in_.size && !frame_done_) {
+        failure_ = "truncated frame";
+        return;
+      }
+    }
+  }
+
+  struct free_context {
+    void operator()(ZSTD_DCtx *context) const noexcept {
+      ZSTD_freeDCtx(context);
+    }
+  };
+
+  std::unique_ptr<ZSTD_DCtx, free_context> context_;
+  ZSTD_inBuffer in_;
+  std::vector<char> &window_;
+  std::size_t pos_ = 0;  ///< Next character in the window
+  std::size_t size_ = 0; ///< Decompressed characters in the window
+  std::size_t consumed_ = 0;
+  bool frame_done_ = false;
+  char const *failure_ = nullptr;
+};
+#endif
+
+/// Parses the contents of path held in text, decompressing them on the fly
+/// if they are a zstd frame
+template <auto Flags, typename Validator>
+result<void> parse_text(std::filesystem::path const &path,
+                        parse_buffers &buffers, Validator &validator,
+                        index_builder const &builder, json_reader &reader) {
+  if (!is_zstd_frame(buffers.text)) {
+    rapidjson::MemoryStream stream(buffers.text.data(), buffers.text.size());
+    return parse_validated<Flags>(stream, validator, builder, reader);
+  }
+#if defined(ER_HWINFO_ZSTD)
+  zstd_stream stream(buffers.text, buffers.window);
+  auto parsed = parse_validated<Flags>(stream, validator, builder, reader);
+  if (stream.failure()) {
+    return error{
+        .code = errc::decompression_failed,
+        .offset = stream.Tell(),
+        .detail = fmt::format("{} ({})", path.string(), stream.failure())};
+  }
+  return parsed;
+#else
+  return error{.code = errc::unsupported_compression,
+               .detail = path.string()};
+#endif
+}
+
+/// Whether hw_type can name the fragment file <hw_type>.json of a hwdb.d
+/// directory without leaving it or clashing with its manifest
+constexpr bool is_fragment_name(std::string_view hw_type) noexcept {
+  return !hw_type.empty() && hw_type != "." && hw_type != ".." &&
+         hw_type != "manifest" && hw_type.find('/') == hw_type.npos &&
+         hw_type.find('\0') == hw_type.npos;
+}
+
+inline std::filesystem::path
+fragment_path(std::filesystem::path const &hwdb_dir,
+              std::string_view hw_type) {
+  return hwdb_dir / fmt::format("{}.json", hw_type);
+}
+
+/// Paths of the fragments listed by the manifest.json of hwdb_dir
+template <auto Flags>
+result<std::vector<std::filesystem::path>>
+read_manifest(std::filesystem::path const &hwdb_dir, std::string &text) {
+  const auto manifest_path = hwdb_dir / "manifest.json";
+  if (auto read = read_file(manifest_path, text); !read) {
+    return read.error();
+  }
+  rapidjson::Document manifest;
+  if (manifest.Parse<Flags>(text.data(), text.size()).HasParseError()) {
+    return parse_error(manifest.GetParseError(), manifest.GetErrorOffset());
+  }
+  const auto invalid = error{.code = errc::invalid_manifest,
+                             .detail = manifest_path.string()};
+  if (!manifest.IsArray()) {
+    return invalid;
+  }
+  std::vector<std::filesystem::path> fragments;
+  fragments.reserve(manifest.Size());
+  for (auto type = manifest.Begin(); type != manifest.End(); ++type) {
+    if (!type->IsString()) {
+      return invalid;
+    }
+    const std::string_view name(type->GetString(), type->GetStringLength());
+    if (!is_fragment_name(name)) {
+      return invalid;
+    }
+    fragments.push_back(fragment_path(hwdb_dir, name));
+  }
+  return fragments;
+}
+
+/// Byte range of the member of one type in a hwdb.json file, as recorded
+/// by its offset index
+struct type_slice {
+  std::size_t begin = 0;  ///< Offset of the quote opening the type name
+  std::size_t end = 0;    ///< Offset past the end of its revisions
+  std::uint64_t hash = 0; ///< name_hash() of the bytes in between
+};
+
+/// A database file to parse, or only the slice of it holding one type
+struct database_source {
+  std::filesystem::path path;
+  std::optional<type_slice> slice;
+};
+
+/// The offset index of a hwdb.json file, see try_write_offset_index()
+inline std::filesystem::path
+offset_index_path(std::filesystem::path const &hwdb_path) {
+  auto path = hwdb_path;
+  path += ".idx";
+  return path;
+}
+
+/// Size and modification time of a file, which its offset index must match
+struct file_stamp {
+  std::uintmax_t size = 0;
+  std::int64_t mtime = 0;
+};
+
+inline std::optional<file_stamp>
+stamp_of(std::filesystem::path const &path) noexcept {
+  std::error_code ec;
+  const auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  const auto mtime = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return std::nullopt;
+  }
+  return file_stamp{
+      .size = size,
+      .mtime = static_cast<std::int64_t>(mtime.time_since_epoch().count())};
+}
+
+/**
+ * SAX handler recording the byte range of every type of a hwdb document
+ * parsed from stream, for the offset index. The first of repeated type
+ * names wins, as in index_builder.
+ */
+class offset_scanner
+    : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, offset_scanner> {
+public:
+  struct entry {
+    std::string name;     ///< Type name
+    std::string_view key; ///< Type name as written, quoted and escaped
+    type_slice slice;
+  };
+
+  offset_scanner(std::string_view text,
+                 rapidjson::MemoryStream const &stream) noexcept
+      : text_(text), stream_(&stream) {}
+
+  bool Default() {
+    if (depth_ == 1) {
+      add_member();
+    }
+    return true;
+  }
+
+  bool Key(Ch const *str, rapidjson::SizeType length, bool) {
+    if (depth_ == 1) {
+      const auto end = stream_->Tell();
+      begin_ = opening_quote(end);
+      key_ = text_.substr(begin_, end - begin_);
+      name_.assign(str, length);
+    }
+    return true;
+  }
+
+  bool StartObject() {
+    root_is_object_ |= depth_ == 0;
+    return start();
+  }
+  bool EndObject(rapidjson::SizeType) { return end(); }
+  bool StartArray() { return start(); }
+  bool EndArray(rapidjson::SizeType) { return end(); }
+
+  /// Members of the root object in document order, duplicates included
+  std::vector<entry> const &types() const noexcept { return types_; }
+
+  /// Whether the document is an object, of which types() are the members
+  bool root_is_object() const noexcept { return root_is_object_; }
+
+private:
+  bool start() {
+    ++depth_;
+    return true;
+  }
+
+  bool end() {
+    if (--depth_ == 1) {
+      add_member();
+    }
+    return true;
+  }
+
+  /// Records the member of the root object ending here
+  void add_member() {
+    const auto end = stream_->Tell();
+    types_.push_back(
+        entry{.name = name_,
+              .key = key_,
+              .slice = {.begin = begin_,
+                        .end = end,
+                        .hash = name_hash(text_.substr(begin_, end - begin_))}});
+  }
+
+  /// Offset of the quote opening the key that ends at end: the nearest
+  /// quote before the closing one that is not escaped
+  std::size_t opening_quote(std::size_t end) const noexcept {
+    auto pos = end - 1;
+    for (;;) {
+      pos = text_.rfind('"', pos - 1);
+      std::size_t backslashes = 0;
+      while (text_[pos - backslashes - 1] == '\\') {
+        ++backslashes;
+      }
+      if (backslashes % 2 == 0) {
+        return pos;
+      }
+    }
+  }
+
+  std::string_view text_;
+  rapidjson::MemoryStream const *stream_;
+  std::vector<entry> types_;
+  std::string name_;
+  std::string_view key_;
+  std::size_t begin_ = 0;
+  int depth_ = 0;
+  bool root_is_object_ = false;
+};
+
+/// The offset index of text, a hwdb document conforming to the built-in
+/// schema, for a file stamped stamp
+template <auto Flags>
+result<std::string> build_offset_index(std::string const &text,
+                                       file_stamp stamp) {
+  rapidjson::MemoryStream stream(text.data(), text.size());
+  offset_scanner scanner(text, stream);
+  compiled_validator<generated::hwdb_schema, offset_scanner> validator(
+      scanner);
+  rapidjson::Reader reader;
+  reader.Parse<Flags>(stream, validator);
+  if (!validator.IsValid()) {
+    return error{.code = errc::schema_violation,
+                 .offset = reader.GetErrorOffset(),
+                 .detail = invalid_schema_pointer(validator)};
+  }
+  if (reader.HasParseError()) {
+    return parse_error(reader.GetParseErrorCode(), reader.GetErrorOffset());
+  }
+  auto out = fmt::format(R"({{"size": {}, "mtime": {}, "types": {{)",
+                         stamp.size, stamp.mtime);
+  char const *separator = "";
+  for (auto const &type : scanner.types()) {
+    // Loading sees the first of duplicate types only
+    if (&*rg::find(scanner.types(), type.name,
+                   &offset_scanner::entry::name) != &type) {
+      continue;
+    }
+    fmt::format_to(std::back_inserter(out), "{}\n  {}: [{}, {}, {}]",
+                   separator, type.key, type.slice.begin, type.slice.end,
+                   type.slice.hash);
+    separator = ",";
+  }
+  out += "\n}}\n";
+  return out;
+}
+
+/// Unsigned integer member name of value, if it has one
+template <typename Value>
+std::optional<std::uint64_t> uint_member(Value const &value,
+                                         char const *name) {
+  const auto member = value.FindMember(name);
+  if (member == value.MemberEnd() || !member->value.IsUint64()) {
+    return std::nullopt;
+  }
+  return member->value.GetUint64();
+}
+
+/// The source holding hw_type according to the offset index of hwdb_path,
+/// none if the index does not list it, or std::nullopt if there is no
+/// index or it does not match the file
+template <auto Flags>
+std::optional<std::vector<database_source>>
+indexed_sources(std::filesystem::path const &hwdb_path,
+                std::string_view hw_type, std::string &text,
+                preloaded_files preloaded) {
+  const auto stamp = stamp_of(hwdb_path);
+  if (!stamp || !read_file(offset_index_path(hwdb_path), text, preloaded)) {
+    return std::nullopt;
+  }
+  rapidjson::Document index;
+  if (index.Parse<Flags>(text.data(), text.size()).HasParseError() ||
+      !index.IsObject()) {
+    return std::nullopt;
+  }
+  const auto mtime = index.FindMember("mtime");
+  const auto types = index.FindMember("types");
+  if (uint_member(index, "size") != stamp->size ||
+      mtime == index.MemberEnd() || !mtime->value.IsInt64() ||
+      mtime->value.GetInt64() != stamp->mtime ||
+      types == index.MemberEnd() || !types->value.IsObject()) {
+    return std::nullopt;
+  }
+  std::vector<database_source> sources;
+  for (auto type = types->value.MemberBegin();
+       type != types->value.MemberEnd(); ++type) {
+    if (std::string_view(type->name.GetString(),
+                         type->name.GetStringLength()) != hw_type) {
+      continue;
+    }
+    // [begin, end, hash]
+    auto const &range = type->value;
+    std::array<std::uint64_t, 3> fields{};
+    if (!range.IsArray() || range.Size() != fields.size()) {
+      return std::nullopt;
+    }
+    for (rapidjson::SizeType i = 0; i < fields.size(); ++i) {
+      if (!range[i].IsUint64()) {
+        return std::nullopt;
+      }
+      fields[i] = range[i].GetUint64();
+    }
+    const auto [begin, end, hash] = fields;
+    if (begin == 0 || begin >= end || end > stamp->size) {
+      return std::nullopt;
+    }
+    sources.push_back(database_source{
+        .path = hwdb_path,
+        .slice = type_slice{.begin = static_cast<std::size_t>(begin),
+                            .end = static_cast<std::size_t>(end),
+                            .hash = hash}});
+    break;
+  }
+  return sources;
+}
+
+/// Reads source into text, from preloaded if it holds the file. A slice
+/// is read as the document holding only its type, or the whole file if
+/// the slice no longer matches its hash.
+/// @return The offset of the file text[i] was read from, less i
+inline result<std::size_t> read_source(database_source const &source,
+                                       std::string &text,
+                                       preloaded_files preloaded) {
+  const auto read_ahead = rg::find(preloaded, source.path, &file_read::path);
+  if (source.slice && read_ahead != preloaded.end()) {
+    auto const &slice = *source.slice;
+    const std::string_view whole = read_ahead->text;
+    if (read_ahead->status && slice.end <= whole.size()) {
+      const auto body = whole.substr(slice.begin, slice.end - slice.begin);
+      if (name_hash(body) == slice.hash) {
+        text.assign(1, '{');
+        text.append(body);
+        text += '}';
+        return slice.begin - 1;
+      }
+    }
+  } else if (source.slice) {
+    auto const &slice = *source.slice;
+    std::ifstream file(source.path, std::ios::binary);
+    if (!file) {
+      return error{.code = errc::file_open_failed,
+                   .detail = source.path.string()};
+    }
+    text.assign(1, '{');
+    text.resize(slice.end - slice.begin + 1);
+    file.seekg(static_cast<std::streamoff>(slice.begin));
+    if (file.read(text.data() + 1,
+                  static_cast<std::streamsize>(text.size() - 1)) &&
+        name_hash(std::string_view(text).substr(1)) == slice.hash) {
+      text += '}';
+      return slice.begin - 1;
+    }
+  }
+  if (auto read = read_file(source.path, text, preloaded); !read) {
+    return read.error();
+  }
+  return 0;
+}
+
+/// What the database at hwdb_path consists of: for a hwdb.json file,
+/// the slice of hw_type if given and the file has an up-to-date offset
+/// index, else the whole file. For a hwdb.d directory, the fragment of
+/// hw_type if given, none if the type has no fragment, else every fragment
+/// of the manifest.
+template <auto Flags>
+result<std::vector<database_source>>
+database_sources(std::filesystem::path const &hwdb_path,
+                 std::optional<std::string_view> hw_type, std::string &text,
+                 preloaded_files preloaded) {
+  std::error_code ec;
+  if (!std::filesystem::is_directory(hwdb_path, ec)) {
+    if (hw_type) {
+      if (auto indexed =
+              indexed_sources<Flags>(hwdb_path, *hw_type, text, preloaded)) {
+        return std::move(*indexed);
+      }
+    }
+    return std::vector{database_source{.path = hwdb_path, .slice = {}}};
+  }
+  std::vector<database_source> sources;
+  if (!hw_type) {
+    auto fragments = read_manifest<Flags>(hwdb_path, text);
+    if (!fragments) {
+      return fragments.error();
+    }
+    for (auto &fragment : *fragments) {
+      sources.push_back(
+          database_source{.path = std::move(fragment), .slice = {}});
+    }
+  } else if (is_fragment_name(*hw_type)) {
+    auto fragment = fragment_path(hwdb_path, *hw_type);
+    if (std::filesystem::exists(fragment, ec)) {
+      sources.push_back(
+          database_source{.path = std::move(fragment), .slice = {}});
+    }
+  }
+  return sources;
+}
+
+/// Reads source and parses it, passing the events through validator into
+/// builder, see parse_text()
+template <auto Flags, typename Validator>
+result<void> parse_source(database_source const &source,
+                          parse_buffers &buffers, Validator &validator,
+                          index_builder const &builder, json_reader &reader,
+                          preloaded_files preloaded) {
+  const auto shift = read_source(source, buffers.text, preloaded);
+  if (!shift) {
+    return shift.error();
+  }
+  auto parsed =
+      parse_text<Flags>(source.path, buffers, validator, builder, reader);
+  if (!parsed) {
+    // Report offsets into the file rather than into the slice
+    auto err = parsed.error();
+    if (err.code == errc::parse_failed ||
+        err.code == errc::schema_violation) {
+      err.offset += *shift;
+    }
+    return err;
+  }
+  return {};
+}
+
+/// Loads the index of sources in a single pass per file or slice: SAX
+/// events flow from the reader through the validator of schema, either a
+/// schema path or builtin_schema, into one index_builder, so that pins are
+/// shared across files too. The file contents, the schema DOM and the
+/// parser stack live in the reusable buffers. Files in preloaded are not
+/// read again.
+template <auto Flags, typename Schema>
+result<type_index> index_sources(std::span<database_source const> sources,
+                                 Schema const &schema, parse_buffers &buffers,
+                                 preloaded_files preloaded) {
+  grow_buffer(buffers.stack, min_buffer_size);
+  grow_buffer(buffers.scratch, min_buffer_size);
+  std::size_t stack_used = 0;
+  std::size_t scratch_used = 0;
+  index_builder builder;
+  result<void> parsed;
+  {
+    pool_allocator stack_allocator(buffers.stack.data(), buffers.stack.size());
+    pool_allocator scratch_allocator(buffers.scratch.data(),
+                                     buffers.scratch.size());
+    json_reader reader(&stack_allocator, parse_stack_capacity);
+    // Parses every source with a fresh validator from make_validator()
+    const auto parse_files = [&](auto const &make_validator) {
+      for (auto const &source : sources) {
+        auto validator = make_validator();
+        parsed = parse_source<Flags>(source, buffers, validator, builder,
+                                     reader, preloaded);
+        if (!parsed) {
+          return;
+        }
+      }
+    };
+
+    if constexpr (std::is_same_v<Schema, builtin_schema_t>) {
+      parse_files([&] {
+        return compiled_validator<generated::hwdb_schema, index_builder>(
+            builder);
+      });
+    } else {
+      buffered_document schema_doc(&scratch_allocator, parse_stack_capacity,
+                                   &stack_allocator);
+      parsed = read_file(schema, buffers.text, preloaded);
+      if (parsed) {
+        parsed = parse_document<Flags>(schema_doc, buffers.text);
+      }
+      if (parsed) {
+        const rapidjson::SchemaDocument schema_document(schema_doc);
+        parse_files([&] {
+          return rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument,
+                                                   index_builder>(
+              schema_document, builder);
+        });
+      }
+    }
+    stack_used = stack_allocator.Capacity();
+    scratch_used = scratch_allocator.Capacity();
+  }
+  // Size the buffers for the next load once nothing refers to them
+  grow_buffer(buffers.stack, stack_used);
+  grow_buffer(buffers.scratch, scratch_used);
+  if (!parsed) {
+    return parsed.error();
+  }
+  return std::move(builder).finish();
+}
+
+/// Loads the index of the database at hwdb_path, or only of the part
+/// holding hw_type, see database_sources() and index_sources()
+template <auto Flags, typename Schema>
+result<type_index> load_index(std::filesystem::path const &hwdb_path,
+                              std::optional<std::string_view> hw_type,
+                              Schema const &schema, parse_buffers &buffers,
+                              preloaded_files preloaded = {}) {
+  auto sources =
+      database_sources<Flags>(hwdb_path, hw_type, buffers.text, preloaded);
+  if (!sources) {
+    return sources.error();
+  }
+  if (sources->empty()) {
+    return type_index{};
+  }
+  return index_sources<Flags>(*sources, schema, buffers, preloaded);
+}
+
+/// Whether checking each member of a document against root_schema as a
+/// document of its own is the same as checking the whole document: false
+/// if the root schema constrains members jointly, e.g. with required or
+/// maxProperties, or uses keywords not known to be per member
+template <typename Value> bool members_independent(Value const &root_schema) {
+  static constexpr std::array<std::string_view, 14> per_member{
+      "$schema",     "$id",         "$comment",   "$defs",
+      "definitions", "title",       "description", "examples",
+      "default",     "type",        "properties", "patternProperties",
+      "additionalProperties",       "propertyNames"};
+  if (!root_schema.IsObject()) {
+    return false;
+  }
+  for (auto member = root_schema.MemberBegin();
+       member != root_schema.MemberEnd(); ++member) {
+    const std::string_view name(member->name.GetString(),
+                                member->name.GetStringLength());
+    if (rg::find(per_member, name) == per_member.end()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// A member of the root object of a hwdb document: a hardware type
+struct member_source {
+  std::string name;
+  database_source source; ///< The member as a slice of its file
+};
+
+/// The members of the hwdb document text, read from path, as slices that
+/// can be checked one by one, or std::nullopt if that could report other
+/// errors than checking text whole: text is compressed, malformed, not an
+/// object or holds a type twice, of which loading skips all but the first
+template <auto Flags>
+std::optional<std::vector<member_source>>
+member_sources(std::filesystem::path const &path, std::string const &text) {
+  if (is_zstd_frame(text)) {
+    return std::nullopt;
+  }
+  rapidjson::MemoryStream stream(text.data(), text.size());
+  offset_scanner scanner(text, stream);
+  rapidjson::Reader reader;
+  reader.Parse<Flags>(stream, scanner);
+  if (reader.HasParseError() || !scanner.root_is_object()) {
+    return std::nullopt;
+  }
+  std::vector<member_source> members;
+  std::set<std::string_view> names;
+  for (auto const &member : scanner.types()) {
+    if (!names.insert(member.name).second) {
+      return std::nullopt;
+    }
+    members.push_back(member_source{
+        .name = member.name,
+        .source = database_source{.path = path, .slice = member.slice}});
+  }
+  return members;
+}
+
+/// Checks the sources on up to threads threads, including the calling one,
+/// each source with an index_builder and a validator of its own from
+/// make_validator(builder), using the parse buffers of each thread
+/// @return The error of the first failing source in order
+template <auto Flags, typename MakeValidator>
+result<void> check_sources(std::span<database_source const> sources,
+                           preloaded_files preloaded,
+                           MakeValidator const &make_validator,
+                           unsigned threads) {
+  if (sources.empty()) {
+    return {};
+  }
+  std::vector<result<void>> results(sources.size());
+  std::atomic<std::size_t> next{0};
+  const auto check = [&] {
+    auto &buffers = thread_parse_buffers();
+    grow_buffer(buffers.stack, min_buffer_size);
+    std::size_t stack_used = 0;
+    {
+      pool_allocator stack_allocator(buffers.stack.data(),
+                                     buffers.stack.size());
+      json_reader reader(&stack_allocator, parse_stack_capacity);
+      for (auto i = next++; i < sources.size(); i = next++) {
+        index_builder builder;
+        auto validator = make_validator(builder);
+        results[i] = parse_source<Flags>(sources[i], buffers, validator,
+                                         builder, reader, preloaded);
+      }
+      stack_used = stack_allocator.Capacity();
+    }
+    grow_buffer(buffers.stack, stack_used);
+  };
+  {
+    std::vector<std::jthread> workers;
+    const auto count = std::clamp<std::size_t>(threads, 1, sources.size());
+    for (std::size_t i = 1; i < count; ++i) {
+      workers.emplace_back(check);
+    }
+    check();
+  }
+  const auto failed = rg::find_if(results, [](auto const &r) { return !r; });
+  return failed == results.end() ? result<void>{} : *failed;
+}
+
+/// Checks the database at hwdb_path as load_index() would load it whole,
+/// on up to threads threads. The fragments of a hwdb.d directory are
+/// checked concurrently, as are the types of a hwdb.json file, see
+/// member_sources(), if schema checks them independently.
+template <auto Flags, typename Schema>
+result<void> validate_index(std::filesystem::path const &hwdb_path,
+                            Schema const &schema, unsigned threads) {
+  std::string text;
+  auto sources = database_sources<Flags>(hwdb_path, std::nullopt, text, {});
+  if (!sources) {
+    return sources.error();
+  }
+  // The file read ahead, for cutting its members from
+  std::vector<file_read> whole;
+  std::error_code ec;
+  const auto split = [&](bool independent) {
+    if (!independent || std::filesystem::is_directory(hwdb_path, ec)) {
+      return;
+    }
+    auto &file = whole.emplace_back(hwdb_path);
+    file.status = read_file(hwdb_path, file.text);
+    if (file.status) {
+      if (auto members = member_sources<Flags>(hwdb_path, file.text)) {
+        sources->clear();
+        for (auto &member : *members) {
+          sources->push_back(std::move(member.source));
+        }
+      }
+    }
+  };
+
+  if constexpr (std::is_same_v<Schema, builtin_schema_t>) {
+    // The built-in schema only has per-member keywords at its root
+    split(true);
+    return check_sources<Flags>(
+        *sources, whole,
+        [](index_builder &builder) {
+          return compiled_validator<generated::hwdb_schema, index_builder>(
+              builder);
+        },
+        threads);
+  } else {
+    if (auto read = read_file(schema, text); !read) {
+      return read.error();
+    }
+    rapidjson::Document schema_doc;
+    if (schema_doc.Parse<Flags>(text.data(), text.size()).HasParseError()) {
+      return parse_error(schema_doc.GetParseError(),
+                         schema_doc.GetErrorOffset());
+    }
+    split(members_independent(schema_doc));
+    const rapidjson::SchemaDocument schema_document(schema_doc);
+    return check_sources<Flags>(
+        *sources, whole,
+        [&](index_builder &builder) {
+          return rapidjson::GenericSchemaValidator<rapidjson::SchemaDocument,
+                                                   index_builder>(
+              schema_document, builder);
+        },
+        threads);
+  }
+}
+
+/// An index together with the hashes of what it was loaded from, if known
+struct loaded_index {
+  type_index types;
+  std::optional<source_hashes> hashes;
+};
+
+/// Loads the database at hwdb_path like load_index(), reusing the types of
+/// previous whose text is unchanged according to previous_hashes, and
+/// indexing only the others. Everything is loaded, without recording
+/// hashes, where only indexing what changed could give another result,
+/// see member_sources() and members_independent().
+template <auto Flags, typename Schema>
+result<loaded_index>
+reload_index(std::filesystem::path const &hwdb_path, Schema const &schema,
+             type_index const &previous,
+             std::optional<source_hashes> const &previous_hashes,
+             parse_buffers &buffers) {
+  const auto load_all = [&]() -> result<loaded_index> {
+    auto index = load_index<Flags>(hwdb_path, std::nullopt, schema, buffers);
+    if (!index) {
+      return index.error();
+    }
+    return loaded_index{.types = std::move(index).value(), .hashes = {}};
+  };
+  auto sources = database_sources<Flags>(hwdb_path, std::nullopt,
+                                         buffers.text, {});
+  if (!sources) {
+    return sources.error();
+  }
+
+  source_hashes hashes;
+  std::vector<file_read> files;
+  if constexpr (!std::is_same_v<Schema, builtin_schema_t>) {
+    auto &schema_file = files.emplace_back(schema);
+    schema_file.status = read_file(schema, schema_file.text);
+    rapidjson::Document schema_doc;
+    if (!schema_file.status ||
+        schema_doc.Parse<Flags>(schema_file.text.data(),
+                                schema_file.text.size())
+            .HasParseError() ||
+        !members_independent(schema_doc)) {
+      return load_all();
+    }
+    hashes.schema = name_hash(schema_file.text);
+  }
+  std::vector<member_source> members;
+  for (auto const &source : *sources) {
+    auto &file = files.emplace_back(source.path);
+    file.status = read_file(source.path, file.text);
+    auto split = file.status ? member_sources<Flags>(source.path, file.text)
+                             : std::nullopt;
+    if (!split) {
+      return load_all();
+    }
+    for (auto &member : *split) {
+      const auto hash = member.source.slice->hash;
+      if (!hashes.types.emplace(member.name, hash).second) {
+        return load_all(); // a type repeated across fragments
+      }
+      members.push_back(std::move(member));
+    }
+  }
+
+  // Types whose text changed, or all if previous was loaded otherwise
+  const bool comparable =
+      previous_hashes && previous_hashes->schema == hashes.schema;
+  const auto unchanged = [&](member_source const &member) {
+    if (!comparable || !previous.contains(member.name)) {
+      return false;
+    }
+    const auto hash = previous_hashes->types.find(member.name);
+    return hash != previous_hashes->types.end() &&
+           hash->second == member.source.slice->hash;
+  };
+  std::vector<database_source> changed;
+  for (auto const &member : members) {
+    if (!unchanged(member)) {
+      changed.push_back(member.source);
+    }
+  }
+  type_index fresh;
+  if (!changed.empty()) {
+    auto index = index_sources<Flags>(changed, schema, buffers, files);
+    if (!index) {
+      return index.error();
+    }
+    fresh = std::move(index).value();
+  }
+
+  type_index types;
+  types.reserve(members.size());
+  for (auto const &member : members) {
+    if (auto node = fresh.extract(member.name)) {
+      types.insert(std::move(node));
+    } else if (unchanged(member)) {
+      types.emplace(member.name, previous.find(member.name)->second);
+    }
+  }
+  return loaded_index{.types = std::move(types), .hashes = std::move(hashes)};
+}
+
+} // namespace impl
+
+inline std::string error::message() const {
+  switch (code) {
+  case errc::no_device:
+    return fmt::format("No device identification in {}", detail);
+  case errc::file_open_failed:
+    return fmt::format("Failed to open json file: {}", detail);
+  case errc::file_read_failed:
+    return fmt::format("Failed to read json file: {}", detail);
+  case errc::file_write_failed:
+    return fmt::format("Failed to write file: {}", detail);
+  case errc::unsupported_compression:
+    return fmt::format(
+        "zstd-compressed json file, but built without ER_HWINFO_ZSTD: {}",
+        detail);
+  case errc::decompression_failed:
+    return fmt::format("Failed to decompress json file: {}", detail);
+  case errc::parse_failed:
+    return fmt::format("Failed to parse JSON file: {} ({})", detail,
+                       offset);
+  case errc::schema_violation:
+    return fmt::format("JSON does not conform to schema: {}", detail);
+  case errc::invalid_revision:
+    return fmt::format("Invalid revision string component: {}",
+                       std::string_view(detail).substr(offset));
+  case errc::gpio_out_of_range:
+    return fmt::format("GPIO number of {} out of range (max 255)", detail);
+  case errc::invalid_manifest:
+    return fmt::format("Invalid hwdb.d manifest: {}", detail);
+  case errc::invalid_base:
+    return fmt::format("Unknown or circular base revision of {}", detail);
+  case errc::string_too_long:
+    return fmt::format("String too long for inline storage: {}", detail);
+  case errc::revision_out_of_range:
+    return fmt::format("Revision out of range (max {}.{}.{}): {}",
+                       impl::revision_major_max,
+                       impl::revision_component_max,
+                       impl::revision_component_max, detail);
+  }
+  return "Unknown error";
+}
+
+/**
+ * @brief Loaded and schema-validated hardware database.
+ *
+ * Holds the hardware database indexed by type name, with the revisions of
+ * each type sorted and their pins decoded, so that it can be loaded once and
+ * used for any number of lookups without touching JSON again. Obtain one via
+ * load_database().
+ */
+class database {
+public:
+  explicit database(
+      impl::type_index types,
+      std::optional<impl::source_hashes> hashes = std::nullopt) noexcept
+      : types_(std::move(types)), hashes_(std::move(hashes)) {}
+
+  /// @brief Find the revisions of a hardware type.
+  /// @return Revisions sorted ascending, or nullptr if the type is unknown
+  impl::revision_list const *find_type(std::string_view hw_type) const {
+    const auto iter = types_.find(hw_type);
+    return iter == types_.end() ? nullptr : &iter->second;
+  }
+
+  /// @brief All hardware types of the database, in no particular order.
+  impl::type_index const &types() const noexcept { return types_; }
+
+  /// @brief Content hashes of the text the database was loaded from, if
+  ///        loaded by try_reload_database().
+  std::optional<impl::source_hashes> const &hashes() const noexcept {
+    return hashes_;
+  }
+
+  /**
+   * @brief Resolve the pins of a device as lookup() does, memoised.
+   *
+   * Results are cached per hardware type and revision, so that repeating
+   * a lookup is a hash probe returning the same shared pin set. The cache
+   * is bounded and safe to use from several threads; copies and moves of
+   * the database start with an empty one.
+   *
+   * @return The pins of the selected revision, which stay valid after the
+   *         database is gone, or nullptr if the device type is unknown or
+   *         no compatible revision is found
+   */
+  std::shared_ptr<const pin_set> cached_pins(device const &dev) const {
+    return pin_cache_.get(dev, [&]() -> std::shared_ptr<const pin_set> {
+      auto const *revisions = find_type(dev.hw_type);
+      if (revisions == nullptr) {
+        return nullptr;
+      }
+      const auto selected = revisions->select(dev.hw_revision);
+      if (selected == revisions->size()) {
+        return nullptr;
+      }
+      return std::make_shared<const pin_set>(
+          revisions->pins[selected]->to_pin_set());
+    });
+  }
+
+  /// @brief Hit and miss counters of cached_pins().
+  pin_cache_stats cache_stats() const { return pin_cache_.stats(); }
+
+private:
+  impl::type_index types_;
+  std::optional<impl::source_hashes> hashes_;
+  mutable impl::pin_cache pin_cache_;
+};
+
+/**
+ * @brief Read the device identification from the device tree.
+ *
+ * First phase of a query: reads the hardware type and revision of the
+ * running device. Pair with load_database() and lookup() to perform each
+ * step of get() exactly once.
+ *
+ * @param dt_base_path Path to the device tree base directory
+ *
+ * @return std::optional<device> with type and revision, or std::nullopt if
+ *         the device tree is missing or invalid
+ */
+inline std::optional<device>
+read_device(std::filesystem::path const &dt_base_path = "/proc/device-tree") {
+  return impl::get_device(dt_base_path);
+}
+
+/**
+ * @brief Load and validate the hardware database without throwing.
+ *
+ * hwdb_path is either a hwdb.json file or a hwdb.d directory holding one
+ * <hw_type>.json fragment per hardware type, each a hwdb document of its
+ * own, and a manifest.json array of the type names. A directory is loaded
+ * as if its fragments, in manifest order, were one file.
+ *
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ * @param buffers Parse buffers reused from previous loads
+ *
+ * @return The validated database, reusable across lookups, or the error
+ *         that prevented loading it: a file that cannot be opened, read or
+ *         parsed, a schema violation, an invalid manifest, or a revision
+ *         key that is not major.minor.patch or exceeds
+ *         65535.16777215.16777215
+ */
+inline result<database>
+try_load_database(std::filesystem::path const &hwdb_path,
+                  std::filesystem::path const &hwdb_schema_path,
+                  parse_buffers &buffers) {
+  auto index = impl::load_index<impl::parse_flags>(
+      hwdb_path, std::nullopt, hwdb_schema_path, buffers);
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index).value());
+}
+
+/// @brief Load the hardware database without throwing, using this thread's
+///        parse buffers.
+/// @see try_load_database() taking parse_buffers
+inline result<database>
+try_load_database(std::filesystem::path const &hwdb_path =
+                      "/etc/er-hwinfo/hwdb.json",
+                  std::filesystem::path const &hwdb_schema_path =
+                      "/etc/er-hwinfo/hwdb-schema.json") {
+  return try_load_database(hwdb_path, hwdb_schema_path,
+                           impl::thread_parse_buffers());
+}
+
+/// @brief Load the hardware database without throwing, validating it
+///        against the schema compiled into the library.
+/// @see load_database() taking builtin_schema_t and parse_buffers
+inline result<database>
+try_load_database(std::filesystem::path const &hwdb_path, builtin_schema_t,
+                  parse_buffers &buffers) {
+  auto index = impl::load_index<impl::parse_flags>(hwdb_path, std::nullopt,
+                                                   builtin_schema, buffers);
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index).value());
+}
+
+/// @brief Load the hardware database without throwing, against the
+///        built-in schema and using this thread's parse buffers.
+/// @see load_database() taking builtin_schema_t and parse_buffers
+inline result<database>
+try_load_database(std::filesystem::path const &hwdb_path, builtin_schema_t) {
+  return try_load_database(hwdb_path, builtin_schema,
+                           impl::thread_parse_buffers());
+}
+
+/**
+ * @brief Load the part of the hardware database describing one hardware
+ *        type, without throwing.
+ *
+ * For a hwdb.d directory (see try_load_database()) only the fragment
+ * <hw_type>.json is read, so the cost does not grow with the number of
+ * other types; a type without a fragment yields an empty database. The
+ * same holds for a hwdb.json file with an up-to-date offset index, see
+ * try_write_offset_index(); other hwdb.json files are loaded whole.
+ *
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param hw_type Hardware type to load, e.g. device::hw_type
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ *
+ * @return A database holding at least hw_type if it is known, or the error
+ *         of try_load_database()
+ */
+inline result<database>
+try_load_type(std::filesystem::path const &hwdb_path,
+              std::string_view hw_type,
+              std::filesystem::path const &hwdb_schema_path) {
+  auto index = impl::load_index<impl::parse_flags>(
+      hwdb_path, hw_type, hwdb_schema_path, impl::thread_parse_buffers());
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index).value());
+}
+
+/// @brief Load one hardware type without throwing, against the built-in
+///        schema.
+/// @see try_load_type() taking a schema path
+inline result<database> try_load_type(std::filesystem::path const &hwdb_path,
+                                      std::string_view hw_type,
+                                      builtin_schema_t) {
+  auto index = impl::load_index<impl::parse_flags>(
+      hwdb_path, hw_type, builtin_schema, impl::thread_parse_buffers());
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index).value());
+}
+
+/**
+ * @brief Write the offset index of a hwdb.json file, without throwing.
+ *
+ * The index, <hwdb_path>.idx, records the byte range of each hardware
+ * type in the file together with the file's size and modification time.
+ * try_load_type() and get() then read and parse only the requested type's
+ * range instead of the whole file. An index that no longer matches the
+ * file's size, modification time or the hash of the range is ignored, and
+ * the whole file is parsed as before. Rewrite the index whenever the file
+ * changes, e.g. after installing it, as copying does not keep the
+ * modification time.
+ *
+ * @param hwdb_path Path to the hardware database JSON file, which must
+ *        conform to the built-in schema
+ *
+ * @return The error that prevented writing the index
+ */
+inline result<void>
+try_write_offset_index(std::filesystem::path const &hwdb_path) {
+  const auto stamp = impl::stamp_of(hwdb_path);
+  if (!stamp) {
+    return error{.code = errc::file_open_failed, .detail = hwdb_path.string()};
+  }
+  std::string text;
+  if (auto read = impl::read_file(hwdb_path, text); !read) {
+    return read.error();
+  }
+  const auto index = impl::build_offset_index<impl::parse_flags>(text, *stamp);
+  if (!index) {
+    return index.error();
+  }
+  // Replace the index atomically, so that loads never see half of it
+  const auto index_path = impl::offset_index_path(hwdb_path);
+  auto temp_path = index_path;
+  temp_path += ".tmp";
+  {
+    std::ofstream out(temp_path, std::ios::binary | std::ios::trunc);
+    out << *index;
+    if (!out) {
+      return error{.code = errc::file_write_failed,
+                   .detail = temp_path.string()};
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(temp_path, index_path, ec);
+  if (ec) {
+    return error{.code = errc::file_write_failed,
+                 .detail = index_path.string()};
+  }
+  return {};
+}
+
+/// @brief Write the offset index of a hwdb.json file.
+/// @see try_write_offset_index()
+inline void write_offset_index(std::filesystem::path const &hwdb_path) {
+  if (auto written = try_write_offset_index(hwdb_path); !written) {
+    impl::throw_error(written.error());
+  }
+}
+
+/**
+ * @brief Check the hardware database on several threads, without throwing
+ *        or keeping what it loads.
+ *
+ * Reports what try_load_database() would, for checking large databases
+ * e.g. in CI. The fragments of a hwdb.d directory are checked
+ * concurrently, and so are the hardware types of a hwdb.json file, each
+ * as a document of its own with its own validator sharing the parsed
+ * schema. Of several failing types, the first in document order is
+ * reported, at its offset in the file. A hwdb.json file is checked whole,
+ * on one thread, if checking its types one by one could report something
+ * else: if it is compressed, malformed or not an object, repeats a type,
+ * or the root of the schema has keywords other than type, properties,
+ * patternProperties, additionalProperties, propertyNames and annotations.
+ *
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ * @param threads Number of threads to check on, including the calling one
+ *
+ * @return The error of try_load_database(), if any
+ */
+inline result<void> try_validate_database(
+    std::filesystem::path const &hwdb_path,
+    std::filesystem::path const &hwdb_schema_path,
+    unsigned threads = std::thread::hardware_concurrency()) {
+  return impl::validate_index<impl::parse_flags>(hwdb_path, hwdb_schema_path,
+                                                 threads);
+}
+
+/// @brief Check the hardware database on several threads against the
+///        built-in schema, without throwing.
+/// @see try_validate_database() taking a schema path
+inline result<void> try_validate_database(
+    std::filesystem::path const &hwdb_path, builtin_schema_t,
+    unsigned threads = std::thread::hardware_concurrency()) {
+  return impl::validate_index<impl::parse_flags>(hwdb_path, builtin_schema,
+                                                 threads);
+}
+
+/// @brief Check the hardware database on several threads.
+/// @throws std::runtime_error with the error of try_validate_database()
+inline void
+validate_database(std::filesystem::path const &hwdb_path,
+                  std::filesystem::path const &hwdb_schema_path,
+                  unsigned threads = std::thread::hardware_concurrency()) {
+  if (auto valid = try_validate_database(hwdb_path, hwdb_schema_path, threads);
+      !valid) {
+    impl::throw_error(valid.error());
+  }
+}
+
+/// @brief Check the hardware database on several threads against the
+///        built-in schema.
+/// @throws std::runtime_error with the error of try_validate_database()
+inline void
+validate_database(std::filesystem::path const &hwdb_path, builtin_schema_t,
+                  unsigned threads = std::thread::hardware_concurrency()) {
+  if (auto valid = try_validate_database(hwdb_path, builtin_schema, threads);
+      !valid) {
+    impl::throw_error(valid.error());
+  }
+}
+
+/**
+ * @brief Load and validate the hardware database.
+ *
+ * Throwing wrapper of try_load_database().
+ *
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ * @param buffers Parse buffers reused from previous loads
+ *
+ * @return The validated database, reusable across lookups
+ *
+ * @throws std::runtime_error if JSON files cannot be opened or parsed
+ * @throws std::runtime_error if JSON fails schema validation
+ * @throws std::runtime_error if a revision key is not major.minor.patch
+ *         or exceeds 65535.16777215.16777215
+ */
+inline database load_database(std::filesystem::path const &hwdb_path,
+                              std::filesystem::path const &hwdb_schema_path,
+                              parse_buffers &buffers) {
+  return impl::value_or_throw(
+      try_load_database(hwdb_path, hwdb_schema_path, buffers));
+}
+
+/// @brief Load the hardware database using this thread's parse buffers.
+/// @see load_database() taking parse_buffers
+inline database
+load_database(std::filesystem::path const &hwdb_path =
+                  "/etc/er-hwinfo/hwdb.json",
+              std::filesystem::path const &hwdb_schema_path =
+                  "/etc/er-hwinfo/hwdb-schema.json") {
+  return load_database(hwdb_path, hwdb_schema_path,
+                       impl::thread_parse_buffers());
+}
+
+/**
+ * @brief Load the hardware database, validating it against the schema
+ *        compiled into the library.
+ *
+ * Faster than validating against a schema file, since no schema is parsed
+ * and the validator is specialised for hwdb-schema.json.
+ *
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param buffers Parse buffers reused from previous loads
+ *
+ * @throws std::runtime_error if the file cannot be opened or parsed
+ * @throws std::runtime_error if JSON fails schema validation
+ * @throws std::runtime_error if a revision key is not major.minor.patch
+ *         or exceeds 65535.16777215.16777215
+ */
+inline database load_database(std::filesystem::path const &hwdb_path,
+                              builtin_schema_t,
+                              parse_buffers &buffers) {
+  return impl::value_or_throw(
+      try_load_database(hwdb_path, builtin_schema, buffers));
+}
+
+/// @brief Load the hardware database against the built-in schema, using this
+///        thread's parse buffers.
+/// @see load_database() taking builtin_schema_t and parse_buffers
+inline database load_database(std::filesystem::path const &hwdb_path,
+                              builtin_schema_t) {
+  return load_database(hwdb_path, builtin_schema,
+                       impl::thread_parse_buffers());
+}
+
+/**
+ * @brief Load the hardware database again without throwing, indexing only
+ *        the hardware types whose JSON text changed since previous.
+ *
+ * Every hardware type is hashed as written; types whose text and schema
+ * are unchanged are taken over from previous, sharing its pin maps, and
+ * only the others are parsed and validated. The result records the hashes
+ * for the next reload. If previous was not itself returned by
+ * try_reload_database(), everything is indexed this once.
+ *
+ * Gives the same result as try_load_database(). Databases it cannot split
+ * into types that are validated independently, such as compressed files or
+ * schemas that constrain the root object as a whole, are loaded whole.
+ *
+ * @param previous Database loaded before from the same path
+ * @param hwdb_path Path to the hardware database JSON file or directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ *
+ * @return The database, or the error of try_load_database()
+ */
+inline result<database>
+try_reload_database(database const &previous,
+                    std::filesystem::path const &hwdb_path,
+                    std::filesystem::path const &hwdb_schema_path) {
+  auto index = impl::reload_index<impl::parse_flags>(
+      hwdb_path, hwdb_schema_path, previous.types(), previous.hashes(),
+      impl::thread_parse_buffers());
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index->types), std::move(index->hashes));
+}
+
+/// @brief Load the hardware database again without throwing, against the
+///        built-in schema, indexing only the types that changed.
+/// @see try_reload_database() taking a schema path
+inline result<database> try_reload_database(
+    database const &previous, std::filesystem::path const &hwdb_path,
+    builtin_schema_t) {
+  auto index = impl::reload_index<impl::parse_flags>(
+      hwdb_path, builtin_schema, previous.types(), previous.hashes(),
+      impl::thread_parse_buffers());
+  if (!index) {
+    return index.error();
+  }
+  return database(std::move(index->types), std::move(index->hashes));
+}
+
+/// @brief Load the hardware database again, indexing only the types that
+///        changed since previous.
+/// @throws std::runtime_error with the error of try_reload_database()
+inline database
+reload_database(database const &previous,
+                std::filesystem::path const &hwdb_path,
+                std::filesystem::path const &hwdb_schema_path) {
+  return impl::value_or_throw(
+      try_reload_database(previous, hwdb_path, hwdb_schema_path));
+}
+
+/// @brief Load the hardware database again against the built-in schema,
+///        indexing only the types that changed since previous.
+/// @throws std::runtime_error with the error of try_reload_database()
+inline database reload_database(database const &previous,
+                                std::filesystem::path const &hwdb_path,
+                                builtin_schema_t) {
+  return impl::value_or_throw(
+      try_reload_database(previous, hwdb_path, builtin_schema));
+}
+
+/// @brief Load the part of the hardware database describing one hardware
+///        type.
+/// @see try_load_type()
+inline database load_type(std::filesystem::path const &hwdb_path,
+                          std::string_view hw_type,
+                          std::filesystem::path const &hwdb_schema_path) {
+  return impl::value_or_throw(
+      try_load_type(hwdb_path, hw_type, hwdb_schema_path));
+}
+
+/// @brief Load one hardware type against the built-in schema.
+/// @see try_load_type() taking builtin_schema_t
+inline database load_type(std::filesystem::path const &hwdb_path,
+                          std::string_view hw_type, builtin_schema_t) {
+  return impl::value_or_throw(
+      try_load_type(hwdb_path, hw_type, builtin_schema));
+}
+
+/**
+ * @brief Find the pin definitions of a device in a loaded database.
+ *
+ * Hot path of lookup(): applies the revision matching algorithm described
+ * on get() without copying any pin, and leaves descriptions untouched until
+ * they are asked for.
+ *
+ * @param dev Device identification, as returned by read_device()
+ * @param db Database, as returned by load_database()
+ *
+ * @return The pins of the selected revision, valid as long as db, or
+ *         nullptr if the device type is unknown or no compatible revision
+ *         is found
+ */
+inline pin_map const *find_pins(device const &dev,
+                                database const &db) noexcept {
+  auto const *revisions = db.find_type(dev.hw_type);
+  if (revisions == nullptr) {
+    return nullptr;
+  }
+  const auto selected = revisions->select(dev.hw_revision);
+  return selected == revisions->size() ? nullptr
+                                       : revisions->pins[selected].get();
+}
+
+/**
+ * @brief Resolve the pin definitions of a device in a loaded database.
+ *
+ * Second phase of a query. Applies the revision matching algorithm
+ * described on get(): one hash lookup of the type and a binary search of
+ * its revisions. The pins are copied, descriptions included; find_pins()
+ * avoids that.
+ *
+ * @param dev Device identification, as returned by read_device()
+ * @param db Database, as returned by load_database()
+ *
+ * @return info for the device; pins are empty if the device type is not in
+ *         the database or no compatible revision is found
+ */
+inline info lookup(device const &dev, database const &db) {
+  auto const *pins = find_pins(dev, db);
+  return info{.dev = dev, .pins = pins ? pins->to_pin_set() : pin_set{}};
+}
+
+/**
+ * @brief Reloadable hardware database shared between threads.
+ *
+ * Publishes immutable database snapshots RCU style: readers announce
+ * themselves on one of two reader counters and then load the current
+ * snapshot, which is wait-free and never takes a lock. A reload builds the
+ * new database off to the side, swaps it in and waits until no reader can
+ * still observe the previous snapshot before releasing it. Concurrent
+ * publishers are serialised among themselves only.
+ *
+ * @par Example:
+ * @code
+ * er::hwinfo::database_handle hwdb(er::hwinfo::load_database());
+ * // reader threads
+ * auto info = hwdb.lookup(dev);
+ * // on hwdb change
+ * hwdb.reload();
+ * @endcode
+ */
+class database_handle {
+public:
+  explicit database_handle(database db)
+      : current_(new database(std::move(db))) {}
+
+  database_handle(database_handle const &) = delete;
+  database_handle &operator=(database_handle const &) = delete;
+
+  ~database_handle() { delete current_.load(); }
+
+  /**
+   * @brief Run fn on the current snapshot.
+   *
+   * The snapshot stays valid for the duration of the call even if a new
+   * one is published concurrently. fn must not publish on this handle.
+   *
+   * @return The result of fn(database const &)
+   */
+  template <typename Fn> decltype(auto) with_snapshot(Fn &&fn) const {
+    const read_guard guard(*this);
+    return std::forward<Fn>(fn)(*guard.db);
+  }
+
+  /// @brief lookup() against the current snapshot; wait-free.
+  info lookup(device const &dev) const {
+    return with_snapshot(
+        [&](database const &db) { return hwinfo::lookup(dev, db); });
+  }
+
+  /// @brief database::cached_pins() of the current snapshot. Each snapshot
+  ///        has a cache of its own.
+  std::shared_ptr<const pin_set> cached_pins(device const &dev) const {
+    return with_snapshot(
+        [&](database const &db) { return db.cached_pins(dev); });
+  }
+
+  /**
+   * @brief Replace the current snapshot.
+   *
+   * Blocks until every reader that may still use the previous snapshot
+   * has finished, then releases it.
+   */
+  void publish(database db) {
+    auto next = std::make_unique<const database>(std::move(db));
+    const std::lock_guard lock(publish_mutex_);
+    const auto *previous = current_.exchange(next.release());
+    // Two flips: wait for the readers of each counter in turn, since a
+    // reader may have registered on either one before the exchange.
+    for (int flip = 0; flip < 2; ++flip) {
+      const auto drained = epoch_.fetch_xor(1) & 1U;
+      while (readers_[drained].load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+    delete previous;
+  }
+
+  /**
+   * @brief Load a new database and publish it.
+   *
+   * Readers keep using the current snapshot while the new one is loaded.
+   * Hardware types unchanged since the current snapshot are taken over
+   * from it, see try_reload_database().
+   *
+   * @throws std::runtime_error if loading fails; the current snapshot is
+   *         kept in that case
+   */
+  void reload(std::filesystem::path const &hwdb_path =
+                  "/etc/er-hwinfo/hwdb.json",
+              std::filesystem::path const &hwdb_schema_path =
+                  "/etc/er-hwinfo/hwdb-schema.json") {
+    const auto loaded = try_reload(hwdb_path, hwdb_schema_path);
+    if (!loaded) {
+      impl::throw_error(loaded.error());
+    }
+  }
+
+  /**
+   * @brief Load a new database and publish it, without throwing.
+   *
+   * @return The error that prevented loading; the current snapshot is kept
+   *         in that case
+   */
+  result<void> try_reload(std::filesystem::path const &hwdb_path =
+                              "/etc/er-hwinfo/hwdb.json",
+                          std::filesystem::path const &hwdb_schema_path =
+                              "/etc/er-hwinfo/hwdb-schema.json") {
+    auto db = with_snapshot([&](database const &current) {
+      return try_reload_database(current, hwdb_path, hwdb_schema_path);
+    });
+    if (!db) {
+      return db.error();
+    }
+    publish(std::move(db).value());
+    return {};
+  }
+
+private:
+  struct read_guard {
+    explicit read_guard(database_handle const &handle)
+        : counter(handle.readers_[handle.epoch_.load() & 1U]) {
+      counter.fetch_add(1);
+      db = handle.current_.load();
+    }
+    read_guard(read_guard const &) = delete;
+    read_guard &operator=(read_guard const &) = delete;
+    ~read_guard() { counter.fetch_sub(1); }
+
+    std::atomic<std::size_t> &counter;
+    database const *db = nullptr;
+  };
+
+  std::atomic<database const *> current_;
+  mutable std::atomic<unsigned> epoch_{0};
+  mutable std::array<std::atomic<std::size_t>, 2> readers_{};
+  std::mutex publish_mutex_;
+};
+
+/**
+ * @brief Pin definition of a database compiled into the program.
+ */
+struct embedded_pin {
+  std::string_view name;        ///< Pin identifier
+  std::uint8_t number;          ///< GPIO pin number
+  std::string_view description; ///< Human-readable description
+};
+
+/**
+ * @brief Pin definitions of one revision of a compiled database.
+ *
+ * Pins are stored in the slot order of a minimal perfect hash over their
+ * names, so find() costs one hash and one string compare.
+ */
+struct embedded_pin_map {
+  std::span<const embedded_pin> pins;   ///< Pins in hash slot order
+  std::span<const std::uint32_t> seeds; ///< Hash seed of each bucket
+
+  /// @brief Find a pin by name.
+  /// @return Pointer to the pin, or nullptr if there is no such pin
+  constexpr embedded_pin const *find(std::string_view name) const noexcept {
+    if (pins.empty()) {
+      return nullptr;
+    }
+    const auto hash = impl::name_hash(name);
+    const auto seed = seeds[impl::hash_bucket(hash, seeds.size())];
+    auto const &candidate = pins[impl::hash_slot(hash, seed, pins.size())];
+    return candidate.name == name ? &candidate : nullptr;
+  }
+
+  /// @brief Copy the pins into a pin_set.
+  pin_set to_pin_set() const {
+    auto &&pinrange = pins | impl::rgv::transform([](embedded_pin const &p) {
+                        return pin{.name = pin_name_string(p.name),
+                                   .number = p.number,
+                                   .description =
+                                       description_string(p.description)};
+                      });
+    return {impl::rg::begin(pinrange), impl::rg::end(pinrange)};
+  }
+};
+
+/// @brief Revision entry of a compiled database.
+struct embedded_revision {
+  revision rev;          ///< Hardware revision
+  embedded_pin_map pins; ///< Pin definitions of the revision
+};
+
+/// @brief Hardware type entry of a compiled database.
+struct embedded_type {
+  std::string_view name; ///< Hardware type identifier
+  std::span<const embedded_revision> revisions; ///< Sorted ascending
+};
+
+/**
+ * @brief Resolve the pin definitions of a device in a compiled database.
+ *
+ * Applies the revision matching algorithm described on get() to a database
+ * generated by er-hwinfo-gen, without any allocation.
+ *
+ * @param dev Device identification, as returned by read_device()
+ * @param hwdb Hardware types sorted by name, as generated by er-hwinfo-gen
+ *
+ * @return The pins of the selected revision, or nullptr if the device type
+ *         is unknown or no compatible revision is found
+ */
+constexpr embedded_pin_map const *
+find_pins(device const &dev, std::span<const embedded_type> hwdb) noexcept {
+  const auto type = impl::rg::lower_bound(
+      hwdb, std::string_view(dev.hw_type), {}, &embedded_type::name);
+  if (type == hwdb.end() || type->name != dev.hw_type) {
+    return nullptr;
+  }
+  const auto rev = impl::select_revision(type->revisions, dev.hw_revision,
+                                         &embedded_revision::rev);
+  return rev == type->revisions.end() ? nullptr : &rev->pins;
+}
+
+namespace impl {
+/// The query started by prefetch(), until a get() for the same paths
+/// takes its result. pending comes from a packaged_task on a detached
+/// thread, so dropping it never waits for the query.
+struct prefetch_state {
+  /// Whether pending may be valid, so that get() only takes the mutex
+  /// after a prefetch()
+  std::atomic<bool> has_pending{false};
+  std::mutex mutex;
+  std::filesystem::path dt_base_path;
+  std::filesystem::path hwdb_path;
+  std::filesystem::path hwdb_schema_path;
+  std::future<result<info>> pending;
+};
+
+inline prefetch_state &prefetched() {
+  static prefetch_state state;
+  return state;
+}
+
+/// The result of the prefetch() for these paths, waiting for it if it is
+/// still in flight, or std::nullopt if there is none. Each prefetch() is
+/// taken by the first call: a prefetch of other paths is discarded then,
+/// as no later get() is expected to ask for them.
+inline std::optional<result<info>>
+take_prefetched(std::filesystem::path const &dt_base_path,
+                std::filesystem::path const &hwdb_path,
+                std::filesystem::path const &hwdb_schema_path) {
+  auto &state = prefetched();
+  if (!state.has_pending.load(std::memory_order_acquire)) {
+    return std::nullopt;
+  }
+  std::future<result<info>> pending;
+  {
+    const std::lock_guard lock(state.mutex);
+    pending = std::move(state.pending);
+    state.has_pending.store(false, std::memory_order_relaxed);
+    if (!pending.valid() || state.dt_base_path != dt_base_path ||
+        state.hwdb_path != hwdb_path ||
+        state.hwdb_schema_path != hwdb_schema_path) {
+      return std::nullopt;
+    }
+  }
+  return pending.get();
+}
+} // namespace impl
+
+/**
+ * @brief Query hardware information for the current device without
+ *        throwing.
+ *
+ * Same as get(), for code built without exceptions or that must not
+ * unwind on the hot path.
+ *
+ * @return info as returned by get(), errc::no_device if the device tree is
+ *         missing or invalid, or the error of try_load_type()
+ */
+inline result<info>
+try_get(std::filesystem::path const &dt_base_path = "/proc/device-tree",
+        std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
+        std::filesystem::path const &hwdb_schema_path =
+            "/etc/er-hwinfo/hwdb-schema.json") {
+  if (auto prefetched =
+          impl::take_prefetched(dt_base_path, hwdb_path, hwdb_schema_path)) {
+    return std::move(*prefetched);
+  }
+  auto const dev = read_device(dt_base_path);
+  if (!dev) {
+    return error{.code = errc::no_device, .detail = dt_base_path.string()};
+  }
+  auto const db = try_load_type(hwdb_path, dev->hw_type, hwdb_schema_path);
+  if (!db) {
+    return db.error();
+  }
+  return lookup(*dev, *db);
+}
+
+/**
+ * @brief Query hardware information for the current device.
+ *
+ * Reads device type and revision from the Linux device tree, then looks up
+ * GPIO pin definitions from the hardware database. Uses intelligent revision
+ * matching to find compatible pin definitions. Equivalent to read_device()
+ * followed by load_type() and lookup(), so that with a hwdb.d directory
+ * only the device's own fragment is parsed. Throwing wrapper of try_get().
+ *
+ * @param dt_base_path Path to the device tree base directory
+ * @param hwdb_path Path to the hardware database JSON file or hwdb.d
+ *        directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ *
+ * @return std::optional<info> containing device info and pins, or std::nullopt
+ *         if the device tree is missing or invalid
+ *
+ * @throws std::runtime_error if JSON files cannot be opened or parsed
+ * @throws std::runtime_error if JSON fails schema validation
+ *
+ * @note Returns info with empty pins if device type is not in the database
+ *       or no compatible revision is found (different major version)
+ *
+ * @par Revision Matching Algorithm:
+ * 1. Exact match: use if device revision matches a database entry exactly
+ * 2. Forward match: use first database revision >= device with same major
+ * 3. Backward search: use highest database revision with same major
+ * 4. No match: return empty pins if no same-major revision exists
+ *
+ * @par Example:
+ * @code
+ * auto info = er::hwinfo::get();
+ * if (info) {
+ *     std::cout << "Type: " << info->dev.hw_type << "\n";
+ *     for (const auto& pin : info->pins) {
+ *         std::cout << pin.name << ": GPIO " << pin.number << "\n";
+ *     }
+ * }
+ * @endcode
+ */
+inline std::optional<info>
+get(std::filesystem::path const &dt_base_path = "/proc/device-tree",
+    std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
+    std::filesystem::path const &hwdb_schema_path =
+        "/etc/er-hwinfo/hwdb-schema.json") {
+  return impl::info_or_throw(
+      try_get(dt_base_path, hwdb_path, hwdb_schema_path));
+}
+
+/**
+ * @brief Query hardware information for the current device without
+ *        throwing, reading all files concurrently.
+ *
+ * Same result as try_get(), but instead of reading the device tree, the
+ * schema and the database one after the other, all of them are read in a
+ * single batch, with io_uring where the kernel offers it and a thread per
+ * file otherwise. Parsing starts once the batch is complete, so on a cold
+ * page cache the wait is about that of the slowest read rather than the
+ * sum of all reads. A hwdb.json file is read in the same batch unless it
+ * has an offset index, see try_write_offset_index(). In that case the
+ * index is read in the batch instead, and only the device's slice is read
+ * after it, so the cost stays independent of the size of the database.
+ * Likewise, the fragment of a hwdb.d directory is read once the device
+ * type is known.
+ *
+ * @return info as returned by get(), errc::no_device if the device tree is
+ *         missing or invalid, or the error of try_load_type()
+ */
+inline result<info> try_get_overlapped(
+    std::filesystem::path const &dt_base_path = "/proc/device-tree",
+    std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
+    std::filesystem::path const &hwdb_schema_path =
+        "/etc/er-hwinfo/hwdb-schema.json") {
+  const auto properties = impl::device_properties(dt_base_path);
+  std::vector<impl::file_read> files(properties.begin(), properties.end());
+  files.emplace_back(hwdb_schema_path);
+  std::error_code ec;
+  if (!std::filesystem::is_directory(hwdb_path, ec)) {
+    // With an index, only the slice of the device type is read, after it
+    const auto index_path = impl::offset_index_path(hwdb_path);
+    files.emplace_back(std::filesystem::exists(index_path, ec) ? index_path
+                                                               : hwdb_path);
+  }
+  impl::read_files(files);
+
+  auto const dev =
+      impl::parse_device(std::span(files).first<properties.size()>());
+  if (!dev) {
+    return error{.code = errc::no_device, .detail = dt_base_path.string()};
+  }
+  auto index = impl::load_index<impl::parse_flags>(
+      hwdb_path, dev->hw_type, hwdb_schema_path, impl::thread_parse_buffers(),
+      files);
+  if (!index) {
+    return index.error();
+  }
+  return lookup(*dev, database(std::move(index).value()));
+}
+
+/**
+ * @brief Query hardware information for the current device, reading all
+ *        files concurrently.
+ *
+ * Throwing wrapper of try_get_overlapped(), with the results, errors and
+ * defaults of get().
+ */
+inline std::optional<info> get_overlapped(
+    std::filesystem::path const &dt_base_path = "/proc/device-tree",
+    std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
+    std::filesystem::path const &hwdb_schema_path =
+        "/etc/er-hwinfo/hwdb-schema.json") {
+  return impl::info_or_throw(
+      try_get_overlapped(dt_base_path, hwdb_path, hwdb_schema_path));
+}
+
+/**
+ * @brief Start querying hardware information in the background.
+ *
+ * Runs try_get_overlapped() on a thread of its own, so that reading the
+ * device tree and loading the database overlap with the rest of program
+ * startup. The first get() or try_get() with the same paths then waits
+ * for and returns that result instead of loading again; later calls load
+ * as usual. The result reflects the files as they were when prefetched.
+ * If the first get() or try_get() asks for other paths, the prefetch is
+ * discarded instead. Calling prefetch() again replaces a result no get()
+ * has taken yet. Neither waits for the discarded query, which finishes on
+ * its detached thread, nor does a prefetch left untaken delay process
+ * exit. Unless a prefetch is pending, get() checks for one with a single
+ * atomic load, without taking a lock.
+ *
+ * Defining ER_HWINFO_PREFETCH before including this header calls
+ * prefetch() with the default paths during static initialization.
+ *
+ * @param dt_base_path Path to the device tree base directory
+ * @param hwdb_path Path to the hardware database JSON file or hwdb.d
+ *        directory
+ * @param hwdb_schema_path Path to the JSON schema for validation
+ */
+inline void
+prefetch(std::filesystem::path const &dt_base_path = "/proc/device-tree",
+         std::filesystem::path const &hwdb_path = "/etc/er-hwinfo/hwdb.json",
+         std::filesystem::path const &hwdb_schema_path =
+             "/etc/er-hwinfo/hwdb-schema.json") {
+  auto &state = impl::prefetched();
+  std::packaged_task<result<info>()> query([=] {
+    return try_get_overlapped(dt_base_path, hwdb_path, hwdb_schema_path);
+  });
+  auto pending = query.get_future();
+  std::thread(std::move(query)).detach();
+  const std::lock_guard lock(state.mutex);
+  state.dt_base_path = dt_base_path;
+  state.hwdb_path = hwdb_path;
+  state.hwdb_schema_path = hwdb_schema_path;
+  std::swap(state.pending, pending);
+  state.has_pending.store(true, std::memory_order_release);
+  // pending, now the replaced prefetch if any, is dropped without waiting
+}
+
+#if defined(ER_HWINFO_PREFETCH)
+namespace impl {
+inline const bool prefetch_at_startup = (prefetch(), true);
+} // namespace impl
+#endif
+
+/**
+ * @brief Where the async API runs its work.
+ *
+ * Called with a task, an executor runs it exactly once on some thread,
+ * typically by posting it to a thread pool, e.g.
+ * `[&](auto task) { asio::post(pool, std::move(task)); }`. It may also run
+ * the task inline, before returning; the awaiting coroutine then resumes
+ * on its own thread once the executor has returned.
+ */
+template <typename Executor>
+concept executor = std::invocable<Executor &, std::function<void()>>;
+
+/**
+ * @brief Awaitable returned by the async API.
+ *
+ * co_await suspends the awaiting coroutine and hands the file I/O and
+ * parsing to the executor. The coroutine is resumed on the executor's
+ * thread once the work is done, so the awaiting thread, e.g. an event
+ * loop, never blocks on it. If the work is done before the executor
+ * returns, e.g. as it runs tasks inline, the coroutine continues on the
+ * awaiting thread instead, without suspending. Await it once.
+ *
+ * @tparam Value What co_await yields
+ * @tparam Result What the work computes, turned into Value on resumption
+ */
+template <typename Value, typename Result, executor Executor>
+class [[nodiscard]] async_operation {
+public:
+  async_operation(Executor executor, std::function<Result()> work,
+                  Value (*finish)(Result &&))
+      : executor_(std::move(executor)), work_(std::move(work)),
+        finish_(finish) {}
+
+  bool await_ready() const noexcept { return false; }
+
+  /// Whichever of the task and await_suspend() finishes second resumes
+  /// the coroutine, so that neither touches the operation after
+  /// resumption may have destroyed it, the executor included
+  bool await_suspend(std::coroutine_handle<> caller) {
+    executor_(std::function<void()>([this, caller] {
+      result_.emplace(work_());
+      if (finished_.exchange(true, std::memory_order_acq_rel)) {
+        // Resuming may destroy this operation, so nothing may follow
+        caller.resume();
+      }
+    }));
+    // False, i.e. continue at once, if the task has completed already
+    return !finished_.exchange(true, std::memory_order_acq_rel);
+  }
+
+  /// The result, or the value for the throwing API, whose errors are thus
+  /// thrown in the awaiting coroutine rather than on the executor
+  Value await_resume() { return finish_(std::move(*result_)); }
+
+private:
+  Executor executor_;
+  std::function<Result()> work_;
+  Value (*finish_)(Result &&);
+  std::optional<Result> result_;
+  /// Set by the first of the task and await_suspend() to finish
+  std::atomic<bool> finished_{false};
+};
+
+namespace impl {
+template <typename T> T pass(T &&value) { return std::move(value); }
+
+/// try_load_database() on copies of the paths, for the async API
+template <typename Schema>
+std::function<result<database>()> load_work(std::filesystem::path hwdb_path,
+                                            Schema schema) {
+  return [hwdb_path = std::move(hwdb_path), schema = std::move(schema)] {
+    return try_load_database(hwdb_path, schema);
+  };
+}
+
+/// try_get() on copies of the paths, for the async API
+inline std::function<result<info>()>
+get_work(std::filesystem::path dt_base_path, std::filesystem::path hwdb_path,
+         std::filesystem::path hwdb_schema_path) {
+  return [dt_base_path = std::move(dt_base_path),
+          hwdb_path = std::move(hwdb_path),
+          hwdb_schema_path = std::move(hwdb_schema_path)] {
+    return try_get(dt_base_path, hwdb_path, hwdb_schema_path);
+  };
+}
+} // namespace impl
+
+/**
+ * @brief Load the hardware database on an executor.
+ *
+ * load_database() for coroutines: the file I/O and parsing run on
+ * executor, and the awaiting coroutine resumes with the database. The
+ * paths are copied, so they need not outlive the call.
+ *
+ * @code
+ * auto db = co_await er::hwinfo::async_load_database(
+ *     [&](auto task) { asio::post(pool, std::move(task)); });
+ * @endcode
+ *
+ * @return An awaitable yielding the database
+ * @throws std::runtime_error from co_await, as load_database()
+ */
+template <executor Executor>
+async_operation<database, result<database>, Executor> async_load_database(
+    Executor executor,
+    std::filesystem::path hwdb_path = "/etc/er-hwinfo/hwdb.json",
+    std::filesystem::path hwdb_schema_path =
+        "/etc/er-hwinfo/hwdb-schema.json") {
+  return {std::move(executor),
+          impl::load_work(std::move(hwdb_path), std::move(hwdb_schema_path)),
+          &impl::value_or_throw<database>};
+}
+
+/// @brief Load the hardware database on an executor, against the built-in
+///        schema.
+/// @see async_load_database() taking a schema path
+template <executor Executor>
+async_operation<database, result<database>, Executor>
+async_load_database(Executor executor, std::filesystem::path hwdb_path,
+                    builtin_schema_t) {
+  return {std::move(executor),
+          impl::load_work(std::move(hwdb_path), builtin_schema),
+          &impl::value_or_throw<database>};
+}
+
+/// @brief Load the hardware database on an executor without throwing.
+/// @return An awaitable yielding the result of try_load_database()
+template <executor Executor>
+async_operation<result<database>, result<database>, Executor>
+async_try_load_database(
+    Executor executor,
+    std::filesystem::path hwdb_path = "/etc/er-hwinfo/hwdb.json",
+    std::filesystem::path hwdb_schema_path =
+        "/etc/er-hwinfo/hwdb-schema.json") {
+  return {std::move(executor),
+          impl::load_work(std::move(hwdb_path), std::move(hwdb_schema_path)),
+          &impl::pass<result<database>>};
+}
+
+/// @brief Load the hardware database on an executor without throwing,
+///        against the built-in schema.
+/// @return An awaitable yielding the result of try_load_database()
+template <executor Executor>
+async_operation<result<database>, result<database>, Executor>
+async_try_load_database(Executor executor, std::filesystem::path hwdb_path,
+                        builtin_schema_t) {
+  return {std::move(executor),
+          impl::load_work(std::move(hwdb_path), builtin_schema),
+          &impl::pass<result<database>>};
+}
+
+/**
+ * @brief Query hardware information for the current device on an
+ *        executor.
+ *
+ * get() for coroutines, with the same defaults: reading the device tree
+ * and the database and the lookup run on executor, and the awaiting
+ * coroutine resumes with the result of get().
+ *
+ * @return An awaitable yielding what get() returns
+ * @throws std::runtime_error from co_await, as get()
+ */
+template <executor Executor>
+async_operation<std::optional<info>, result<info>, Executor>
+async_get(Executor executor,
+          std::filesystem::path dt_base_path = "/proc/device-tree",
+          std::filesystem::path hwdb_path = "/etc/er-hwinfo/hwdb.json",
+          std::filesystem::path hwdb_schema_path =
+              "/etc/er-hwinfo/hwdb-schema.json") {
+  return {std::move(executor),
+          impl::get_work(std::move(dt_base_path), std::move(hwdb_path),
+                         std::move(hwdb_schema_path)),
+          &impl::info_or_throw};
+}
+
+/// @brief Query hardware information on an executor without throwing.
+/// @return An awaitable yielding the result of try_get()
+template <executor Executor>
+async_operation<result<info>, result<info>, Executor>
+async_try_get(Executor executor,
+              std::filesystem::path dt_base_path = "/proc/device-tree",
+              std::filesystem::path hwdb_path = "/etc/er-hwinfo/hwdb.json",
+              std::filesystem::path hwdb_schema_path =
+                  "/etc/er-hwinfo/hwdb-schema.json") {
+  return {std::move(executor),
+          impl::get_work(std::move(dt_base_path), std::move(hwdb_path),
+                         std::move(hwdb_schema_path)),
+          &impl::pass<result<info>>};
+}
+
+} // namespace hwinfo
+} // namespace er
+
+/// Formats er::hwinfo::fixed_string like std::string_view
+template <std::size_t Capacity>
+struct fmt::formatter<er::hwinfo::fixed_string<Capacity>>
+    : fmt::formatter<std::string_view> {
+  template <typename FormatContext>
+  auto format(er::hwinfo::fixed_string<Capacity> const &text,
+              FormatContext &ctx) const {
+    return fmt::formatter<std::string_view>::format(text.view(), ctx);
+  }
+};
@@ -0,0 +1,227 @@
+#include <er/hwinfo.hpp>
+
+#include <algorithm>
+#include <fmt/format.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr std::string_view usage =
+    "Usage: er-hwinfo-gen HWDB SCHEMA OUTPUT [NAME]\n"
+    "       er-hwinfo-gen --index HWDB\n"
+    "       er-hwinfo-gen --validate HWDB [SCHEMA]\n"
+    "Compiles a hardware database into a C++ header defining\n"
+    "er::hwinfo::generated::NAME (default: hwdb) for find_pins(),\n"
+    "writes the offset index HWDB.idx for loading single types, or\n"
+    "validates HWDB on all cores, against the built-in schema by default.\n";
+
+struct pin_entry {
+  std::string name;
+  unsigned number;
+  std::string description;
+};
+
+struct revision_entry {
+  er::hwinfo::revision rev;
+  std::vector<pin_entry> pins;
+};
+
+struct type_entry {
+  std::string name;
+  std::vector<revision_entry> revisions;
+};
+
+/// Quotes text as a C++ string literal. Everything but printable ASCII is
+/// written as an octal escape, which unlike \x cannot swallow the next char.
+std::string quote(std::string_view text) {
+  std::string out = "\"";
+  for (const unsigned char c : text) {
+    if (c == '"' || c == '\\') {
+      out += '\\';
+      out += static_cast<char>(c);
+    } else if (c >= 0x20 && c < 0x7f) {
+      out += static_cast<char>(c);
+    } else {
+      out += fmt::format("\\{:03o}", c);
+    }
+  }
+  return out + '"';
+}
+
+std::vector<type_entry> collect(er::hwinfo::database const &db) {
+  std::vector<type_entry> types;
+  for (auto const &[name, revisions] : db.types()) {
+    auto &entry = types.emplace_back(type_entry{name, {}});
+    for (std::size_t i = 0; i < revisions.size(); ++i) {
+      auto &rev_entry = entry.revisions.emplace_back(
+          revision_entry{revisions.revision_at(i), {}});
+      auto const &pins = *revisions.pins[i];
+      for (std::size_t p = 0; p < pins.size(); ++p) {
+        rev_entry.pins.push_back(pin_entry{std::string(pins.name(p)),
+                                           pins.number(p),
+                                           std::string(pins.description(p))});
+      }
+    }
+  }
+  std::ranges::sort(types, {}, &type_entry::name);
+  return types;
+}
+
+/// Identifies the pins of rev by content
+std::string pins_key(revision_entry const &rev) {
+  std::string key;
+  for (auto const &pin : rev.pins) {
+    key += fmt::format("{}:{}{}:{}:{}", pin.name.size(), pin.name, pin.number,
+                       pin.description.size(), pin.description);
+  }
+  return key;
+}
+
+void generate_pins(std::ostream &out, std::string const &prefix,
+                   revision_entry const &rev, std::string_view type_name) {
+  std::vector<std::string_view> names;
+  for (auto const &pin : rev.pins) {
+    names.push_back(pin.name);
+  }
+  const auto hash = er::hwinfo::impl::build_perfect_hash(names);
+  if (!hash) {
+    throw std::runtime_error(fmt::format("{} {}: duplicate pin names",
+                                         type_name, rev.rev.as_string()));
+  }
+  std::vector<pin_entry const *> slots(rev.pins.size());
+  for (std::size_t i = 0; i < rev.pins.size(); ++i) {
+    slots[hash->slots[i]] = &rev.pins[i];
+  }
+  out << fmt::format("inline constexpr embedded_pin {}_pins[] = {{\n", prefix);
+  for (const auto *pin : slots) {
+    out << fmt::format("    {{{}, {}, {}}},\n", quote(pin->name), pin->number,
+                       quote(pin->description));
+  }
+  out << fmt::format("}};\ninline constexpr std::uint32_t {}_seeds[] = {{",
+                     prefix);
+  for (std::size_t i = 0; i < hash->seeds.size(); ++i) {
+    out << (i ? ", " : "") << hash->seeds[i];
+  }
+  out << "};\n";
+}
+
+std::string generate(std::vector<type_entry> const &types,
+                     std::string_view name, std::string_view source) {
+  std::ostringstream out;
+  out << fmt::format("// Generated by er-hwinfo-gen from {}. Do not edit.\n"
+                     "#pragma once\n\n"
+                     "#include <er/hwinfo.hpp>\n\n"
+                     "namespace er {{\nnamespace hwinfo {{\n"
+                     "namespace generated {{\nnamespace {}_data {{\n\n",
+                     source, name);
+  // Revisions with identical pins, of any type, share one table
+  std::map<std::string, std::string> tables;
+  for (std::size_t t = 0; t < types.size(); ++t) {
+    auto const &revisions = types[t].revisions;
+    std::vector<std::string> prefixes(revisions.size());
+    for (std::size_t r = 0; r < revisions.size(); ++r) {
+      if (revisions[r].pins.empty()) {
+        continue;
+      }
+      const auto [table, inserted] = tables.try_emplace(
+          pins_key(revisions[r]), fmt::format("t{}_r{}", t, r));
+      if (inserted) {
+        generate_pins(out, table->second, revisions[r], types[t].name);
+      }
+      prefixes[r] = table->second;
+    }
+    if (revisions.empty()) {
+      continue;
+    }
+    out << fmt::format("inline constexpr embedded_revision t{}_revisions[] = "
+                       "{{\n",
+                       t);
+    for (std::size_t r = 0; r < revisions.size(); ++r) {
+      auto const &rev = revisions[r].rev;
+      out << fmt::format("    {{{{{}, {}, {}}}, ", rev.major, rev.minor,
+                         rev.patch);
+      out << (prefixes[r].empty()
+                  ? std::string("{}")
+                  : fmt::format("{{{0}_pins, {0}_seeds}}", prefixes[r]));
+      out << "},\n";
+    }
+    out << "};\n\n";
+  }
+  out << fmt::format("}} // namespace {}_data\n\n"
+                     "/// Hardware database compiled from {}\n"
+                     "inline constexpr embedded_type {}[] = {{\n",
+                     name, source, name);
+  for (std::size_t t = 0; t < types.size(); ++t) {
+    out << fmt::format("    {{{}, {}}},\n", quote(types[t].name),
+                       types[t].revisions.empty()
+                           ? std::string("{}")
+                           : fmt::format("{}_data::t{}_revisions", name, t));
+  }
+  out << "};\n\n} // namespace generated\n} // namespace hwinfo\n"
+         "} // namespace er\n";
+  return out.str();
+}
+
+/// Writes content unless the file already holds it, so that dependents are
+/// not rebuilt needlessly
+void write_if_changed(std::string const &path, std::string const &content) {
+  {
+    std::ifstream in(path, std::ios::binary);
+    std::ostringstream current;
+    current << in.rdbuf();
+    if (in && current.str() == content) {
+      return;
+    }
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out << content;
+  if (!out) {
+    throw std::runtime_error(fmt::format("Failed to write {}", path));
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  if (argc == 3 && std::string_view(argv[1]) == "--index") {
+    const auto written = er::hwinfo::try_write_offset_index(argv[2]);
+    if (!written) {
+      std::cerr << fmt::format("er-hwinfo-gen: {}\n",
+                               written.error().message());
+      return 1;
+    }
+    return 0;
+  }
+  if ((argc == 3 || argc == 4) && std::string_view(argv[1]) == "--validate") {
+    const auto valid =
+        argc == 4
+            ? er::hwinfo::try_validate_database(argv[2], argv[3])
+            : er::hwinfo::try_validate_database(argv[2],
+                                                er::hwinfo::builtin_schema);
+    if (!valid) {
+      std::cerr << fmt::format("er-hwinfo-gen: {}\n", valid.error().message());
+      return 1;
+    }
+    return 0;
+  }
+  if (argc < 4 || argc > 5) {
+    std::cerr << usage;
+    return 2;
+  }
+  const std::string_view name = argc > 4 ? argv[4] : "hwdb";
+  try {
+    const auto db = er::hwinfo::load_database(argv[1], argv[2]);
+    const auto source = std::filesystem::path(argv[1]).filename().string();
+    write_if_changed(argv[3], generate(collect(db), name, source));
+  } catch (const std::exception &e) {
+    std::cerr << fmt::format("er-hwinfo-gen: {}\n", e.what());
+    return 1;
+  }
+  return 0;
+}
@@ -1,14 +1,216 @@
 #include <er/hwinfo.hpp>
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
 #include <fmt/format.h>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
 
-int main(int argc, char *argv[]) {
-  const char *dt_path = argc > 1 ? argv[1] : "/proc/device-tree";
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+void print_timing(std::string_view phase, clock_type::time_point start) {
+  const std::chrono::duration<double, std::milli> elapsed =
+      clock_type::now() - start;
+  std::cerr << fmt::format("{}: {:.3f} ms\n", phase, elapsed.count());
+}
+
+constexpr std::string_view usage =
+    "Usage: er-hwinfo [--timing] [--hwdb PATH] [--schema PATH]\n"
+    "                 [--jobs N] [--manifest FILE] [DEVICE_TREE_PATH...]\n";
+
+struct options {
+  std::vector<std::string> dt_paths;
+  std::optional<std::string> manifest;
+  std::string hwdb_path = "/etc/er-hwinfo/hwdb.json";
+  std::optional<std::string> schema_path; ///< built-in schema if unset
+  unsigned jobs = 1;
+  bool timing = false;
+};
+
+std::optional<options> parse_options(int argc, char *argv[]) {
+  options opts;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg(argv[i]);
+    const bool has_value = i + 1 < argc;
+    if (arg == "--timing") {
+      opts.timing = true;
+    } else if (arg == "--hwdb" && has_value) {
+      opts.hwdb_path = argv[++i];
+    } else if (arg == "--schema" && has_value) {
+      opts.schema_path = argv[++i];
+    } else if (arg == "--manifest" && has_value) {
+      opts.manifest = argv[++i];
+    } else if (arg == "--jobs" && has_value) {
+      const std::string_view value(argv[++i]);
+      const auto res =
+          std::from_chars(value.begin(), value.end(), opts.jobs);
+      if (res.ec != std::errc() || res.ptr != value.end() || opts.jobs == 0) {
+        return std::nullopt;
+      }
+    } else if (arg.starts_with("--")) {
+      return std::nullopt;
+    } else {
+      opts.dt_paths.emplace_back(arg);
+    }
+  }
+  return opts;
+}
+
+/// One unit of batch work: either a device tree snapshot or a manifest line
+struct batch_job {
+  std::string source;
+  std::optional<er::hwinfo::device> dev; ///< preset for manifest entries
+};
+
+/// Parses "type major.minor.patch" manifest lines, skipping blanks and '#'
+/// comments. Returns false if any line is malformed.
+bool read_manifest(std::string const &path, std::vector<batch_job> &jobs) {
+  std::ifstream file(path);
+  if (!file) {
+    std::cerr << fmt::format("Failed to open manifest: {}\n", path);
+    return false;
+  }
+  bool ok = true;
+  std::string line;
+  for (std::size_t line_no = 1; std::getline(file, line); ++line_no) {
+    std::string_view view(line);
+    const auto first = view.find_first_not_of(" \t\r");
+    if (first == std::string_view::npos || view[first] == '#') {
+      continue;
+    }
+    view.remove_prefix(first);
+    view = view.substr(0, view.find_last_not_of(" \t\r") + 1);
+    const auto sep = view.find_first_of(" \t");
+    const auto rev_pos = view.find_first_not_of(" \t", sep);
+    if (sep == std::string_view::npos || rev_pos == std::string_view::npos) {
+      std::cerr << fmt::format("{}:{}: expected 'type major.minor.patch'\n",
+                               path, line_no);
+      ok = false;
+      continue;
+    }
+    const auto rev =
+        er::hwinfo::impl::try_extract_revision(view.substr(rev_pos));
+    if (!rev) {
+      std::cerr << fmt::format("{}:{}: {}\n", path, line_no,
+                               rev.error().message());
+      ok = false;
+      continue;
+    }
+    er::hwinfo::device dev{.hw_type = {}, .hw_revision = *rev};
+    if (!er::hwinfo::impl::assign_text(dev.hw_type, view.substr(0, sep))) {
+      std::cerr << fmt::format("{}:{}: type name too long\n", path, line_no);
+      ok = false;
+      continue;
+    }
+    jobs.push_back(batch_job{
+        .source = fmt::format("{}:{}", path, line_no),
+        .dev = dev,
+    });
+  }
+  return ok;
+}
+
+/// Formats one result line: source, type, revision and NAME=GPIO pairs,
+/// tab separated. Missing fields are printed as '-'.
+std::string format_result(batch_job const &job,
+                          er::hwinfo::database const *db) {
+  const auto dev = job.dev ? job.dev : er::hwinfo::read_device(job.source);
+  if (!dev) {
+    return fmt::format("{}\t-\t-\t-\n", job.source);
+  }
+  // names and numbers only, so descriptions are never touched
+  auto const *pins = db ? er::hwinfo::find_pins(*dev, *db) : nullptr;
+  std::string pin_list;
+  for (std::size_t i = 0; pins && i < pins->size(); ++i) {
+    pin_list += fmt::format("{}{}={}", pin_list.empty() ? "" : ",",
+                            pins->name(i), pins->number(i));
+  }
+  return fmt::format("{}\t{}\t{}\t{}\n", job.source, dev->hw_type,
+                     dev->hw_revision.as_string(),
+                     pin_list.empty() ? "-" : pin_list);
+}
+
+/// Resolves all jobs, printing results in input order as soon as they are
+/// available. Work is spread over `jobs` threads.
+void run_batch(std::vector<batch_job> const &batch,
+               er::hwinfo::database const *db, unsigned jobs) {
+  if (jobs <= 1) {
+    for (const auto &job : batch) {
+      std::cout << format_result(job, db) << std::flush;
+    }
+    return;
+  }
+
+  std::vector<std::optional<std::string>> results(batch.size());
+  std::atomic<std::size_t> next{0};
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::vector<std::jthread> workers;
+  for (unsigned i = 0; i < std::min<std::size_t>(jobs, batch.size()); ++i) {
+    workers.emplace_back([&] {
+      for (std::size_t idx; (idx = next.fetch_add(1)) < batch.size();) {
+        auto line = format_result(batch[idx], db);
+        const std::lock_guard lock(mutex);
+        results[idx] = std::move(line);
+        ready.notify_all();
+      }
+    });
+  }
+  for (std::size_t idx = 0; idx < batch.size(); ++idx) {
+    std::unique_lock lock(mutex);
+    ready.wait(lock, [&] { return results[idx].has_value(); });
+    std::cout << *results[idx] << std::flush;
+    results[idx]->clear();
+  }
+}
+
+/// Loads the database, or only what it holds on hw_type if given, which
+/// with a hwdb.d directory parses a single fragment
+std::optional<er::hwinfo::database>
+try_load_database(options const &opts,
+                  std::optional<std::string_view> hw_type = std::nullopt) {
+  const auto start = clock_type::now();
+  const auto load = [&](auto const &schema) {
+    return hw_type ? er::hwinfo::try_load_type(opts.hwdb_path, *hw_type,
+                                               schema)
+                   : er::hwinfo::try_load_database(opts.hwdb_path, schema);
+  };
+  auto db = opts.schema_path
+                ? load(std::filesystem::path(*opts.schema_path))
+                : load(er::hwinfo::builtin_schema);
+  if (!db) {
+    // hwdb not usable, report why and continue without pin info
+    std::cerr << fmt::format("Hardware database unavailable: {}\n",
+                             db.error().message());
+    return std::nullopt;
+  }
+  if (opts.timing) {
+    print_timing("load_database", start);
+  }
+  return std::move(db).value();
+}
+
+int run_single(options const &opts) {
+  const char *dt_path =
+      opts.dt_paths.empty() ? "/proc/device-tree" : opts.dt_paths[0].c_str();
 
   // First check if device exists
-  auto const dev = er::hwinfo::impl::get_device(dt_path);
+  auto start = clock_type::now();
+  auto const dev = er::hwinfo::read_device(dt_path);
+  if (opts.timing) {
+    print_timing("read_device", start);
+  }
   if (!dev) {
     std::cout << "No Effective Range device found.\n";
     return 1;
@@ -20,13 +222,12 @@ int main(int argc, char *argv[]) {
 
   // Try to get pin information (may fail if hwdb files are missing)
   er::hwinfo::pin_set pins;
-  try {
-    auto const info = er::hwinfo::get(dt_path);
-    if (info) {
-      pins = info->pins;
+  if (auto const db = try_load_database(opts, dev->hw_type)) {
+    start = clock_type::now();
+    pins = er::hwinfo::lookup(*dev, *db).pins;
+    if (opts.timing) {
+      print_timing("lookup", start);
     }
-  } catch (const std::runtime_error &) {
-    // hwdb files not available, continue without pin info
   }
 
   if (pins.empty()) {
@@ -55,4 +256,33 @@ int main(int argc, char *argv[]) {
   }
 
   return 0;
-}
\ No newline at end of file
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const auto opts = parse_options(argc, argv);
+  if (!opts) {
+    std::cerr << usage;
+    return 2;
+  }
+  if (!opts->manifest && opts->dt_paths.size() <= 1) {
+    return run_single(*opts);
+  }
+
+  // Batch mode: load the database once, resolve every entry against it
+  std::vector<batch_job> batch;
+  bool ok = !opts->manifest || read_manifest(*opts->manifest, batch);
+  for (const auto &path : opts->dt_paths) {
+    batch.push_back(batch_job{.source = path, .dev = std::nullopt});
+  }
+  auto const db = try_load_database(*opts);
+  const auto start = clock_type::now();
+  run_batch(batch, db ? &*db : nullptr, opts->jobs);
+  if (opts->timing) {
+    print_timing("batch", start);
+  }
+  // Without the database no pins were resolved, which must not pass
+  // unnoticed, e.g. on a factory line
+  return ok && db ? 0 : 1;
+}
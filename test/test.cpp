@@ -2,16 +2,31 @@
 #include <catch2/catch_test_macros.hpp>
 
 #include <er/hwinfo.hpp>
+#if defined(ER_HWINFO_TEST_EMBEDDED)
+#include <er/hwinfo/hwdb_embedded.hpp>
+#endif
 
 #include <array>
+#include <atomic>
+#include <charconv>
+#include <chrono>
 #include <cstdint>
 #include <cstdio>
 #include <filesystem>
 #include <fstream>
+#include <future>
+#include <random>
+#include <set>
+#include <thread>
+#include <vector>
 
 #include <arpa/inet.h>
 #include <sys/wait.h>
 
+#if defined(ER_HWINFO_ZSTD)
+#include <zstd.h>
+#endif
+
 namespace {
 
 class TempDir {
@@ -66,6 +81,19 @@ TEST_CASE("get_device returns device info when all files exist",
   REQUIRE(result->hw_revision.patch == 3);
 }
 
+TEST_CASE("get_device strips the NUL terminating the type property",
+          "[get_device]") {
+  TempDir temp;
+  // Device tree string properties end in a NUL
+  create_device_tree(temp.path(), std::string("test-board\0", 11), 1, 2, 3);
+
+  auto result = er::hwinfo::impl::get_device(temp.path());
+
+  REQUIRE(result.has_value());
+  REQUIRE(result->hw_type == "test-board");
+  REQUIRE(std::string_view(result->hw_type).size() == 10);
+}
+
 TEST_CASE("get_device returns nullopt when base directory does not exist",
           "[get_device]") {
   auto result = er::hwinfo::impl::get_device("/nonexistent/path");
@@ -306,6 +334,7 @@ TEST_CASE("get returns nullopt when device tree is missing", "[get]") {
   REQUIRE_FALSE(result.has_value());
 }
 
+#if defined(__cpp_exceptions)
 TEST_CASE("get throws when schema file does not exist", "[get]") {
   TempDir temp;
   create_device_tree(temp.path(), "test-board", 1, 2, 3);
@@ -359,6 +388,7 @@ TEST_CASE("get throws when hwdb does not conform to schema", "[get]") {
                                     temp.path() / "schema.json"),
                     std::runtime_error);
 }
+#endif
 
 TEST_CASE("get returns info with empty pins when device type not in hwdb",
           "[get]") {
@@ -397,6 +427,25 @@ TEST_CASE("get returns info with pins when device type exists in hwdb",
   REQUIRE(it->description == "Status LED");
 }
 
+TEST_CASE("get resolves pins of a NUL-terminated device type", "[get]") {
+  TempDir temp;
+  create_device_tree(temp.path(), std::string("test-board\0", 11), 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  auto result = er::hwinfo::get(temp.path(), temp.path() / "hwdb.json",
+                                temp.path() / "schema.json");
+  REQUIRE(result.has_value());
+  REQUIRE(result->dev.hw_type == "test-board");
+  REQUIRE(result->pins.size() == 1);
+
+  auto const dev = er::hwinfo::read_device(temp.path());
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+  REQUIRE(dev.has_value());
+  REQUIRE(er::hwinfo::lookup(*dev, db).pins.size() == 1);
+}
+
 TEST_CASE("get parses multiple pins correctly", "[get]") {
   TempDir temp;
   create_device_tree(temp.path(), "test-board", 1, 0, 0);
@@ -679,6 +728,695 @@ TEST_CASE("get returns empty pins when device major exceeds all hwdb majors",
   REQUIRE(result->pins.empty());
 }
 
+// --- Tests for the two-phase read_device / lookup API ---
+
+TEST_CASE("read_device matches get_device", "[read_device]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+
+  auto result = er::hwinfo::read_device(temp.path());
+
+  REQUIRE(result.has_value());
+  REQUIRE(result->hw_type == "test-board");
+  REQUIRE(result->hw_revision == er::hwinfo::revision{1, 2, 3});
+  REQUIRE_FALSE(er::hwinfo::read_device(temp.path() / "nonexistent"));
+}
+
+#if defined(__cpp_exceptions)
+TEST_CASE("load_database throws when hwdb does not conform to schema",
+          "[load_database]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", R"({ "test-board": { "1.0.0": {} } })");
+
+  REQUIRE_THROWS_AS(er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                              temp.path() / "schema.json"),
+                    std::runtime_error);
+}
+#endif
+
+TEST_CASE("load_database reuses parse buffers across reloads",
+          "[load_database]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  er::hwinfo::parse_buffers buffers;
+
+  auto const first = er::hwinfo::load_database(
+      temp.path() / "hwdb.json", temp.path() / "schema.json", buffers);
+  const auto *text = buffers.text.data();
+  const auto *stack = buffers.stack.data();
+  const auto *scratch = buffers.scratch.data();
+
+  auto const second = er::hwinfo::load_database(
+      temp.path() / "hwdb.json", temp.path() / "schema.json", buffers);
+
+  REQUIRE(buffers.text.data() == text);
+  REQUIRE(buffers.stack.data() == stack);
+  REQUIRE(buffers.scratch.data() == scratch);
+  // Earlier databases stay valid after the buffers are reused
+  REQUIRE(er::hwinfo::lookup({"test-board", {1, 2, 3}}, first).pins.size() == 1);
+  REQUIRE(er::hwinfo::lookup({"test-board", {1, 2, 3}}, second).pins.size() == 1);
+}
+
+TEST_CASE("lookup resolves several devices against one database",
+          "[lookup]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", R"({
+    "test-board": {
+      "1.5.0": {
+        "pins": {
+          "V1_PIN": { "description": "Version 1 pin", "value": 10 }
+        }
+      },
+      "2.0.0": {
+        "pins": {
+          "V2_PIN": { "description": "Version 2 pin", "value": 20 }
+        }
+      }
+    }
+  })");
+
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+
+  auto v1 = er::hwinfo::lookup({"test-board", {1, 9, 0}}, db);
+  REQUIRE(v1.dev.hw_type == "test-board");
+  REQUIRE(v1.pins.size() == 1);
+  REQUIRE(v1.pins.begin()->name == "V1_PIN");
+
+  auto v2 = er::hwinfo::lookup({"test-board", {2, 0, 0}}, db);
+  REQUIRE(v2.pins.size() == 1);
+  REQUIRE(v2.pins.begin()->name == "V2_PIN");
+
+  REQUIRE(er::hwinfo::lookup({"test-board", {3, 0, 0}}, db).pins.empty());
+  REQUIRE(er::hwinfo::lookup({"other-board", {1, 0, 0}}, db).pins.empty());
+}
+
+TEST_CASE("database indexes types with sorted revisions", "[lookup]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  std::string hwdb = "{";
+  for (int t = 0; t < 200; ++t) {
+    hwdb += fmt::format(R"({}"board-{}": {{)", t ? "," : "", t);
+    hwdb += R"("2.0.0": { "pins": {} },)";
+    hwdb += fmt::format(R"("1.0.{}": {{ "pins": {{ "PIN": {{ )"
+                        R"("description": "pin", "value": {} }} }} }})",
+                        t, t % 256);
+    hwdb += "}";
+  }
+  write_text_file(temp.path() / "hwdb.json", hwdb + "}");
+
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+
+  REQUIRE(db.types().size() == 200);
+  REQUIRE(db.find_type("board-200") == nullptr);
+  auto const *revisions = db.find_type("board-42");
+  REQUIRE(revisions != nullptr);
+  REQUIRE(revisions->size() == 2);
+  REQUIRE(revisions->revision_at(0) == er::hwinfo::revision{1, 0, 42});
+  REQUIRE(revisions->revision_at(1) == er::hwinfo::revision{2, 0, 0});
+  auto const result = er::hwinfo::lookup({"board-42", {1, 0, 0}}, db);
+  REQUIRE(result.pins.size() == 1);
+  REQUIRE(result.pins.begin()->number == 42);
+}
+
+TEST_CASE("load_database skips values the index does not use", "[lookup]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", R"({
+    "test-board": {
+      "1.2.3": {
+        "notes": { "pins": { "GHOST": { "description": "", "value": 1 } } },
+        "pins": {
+          "LED": {
+            "description": "Status LED",
+            "value": 17,
+            "extra": { "value": 99, "description": ["ignored"] }
+          }
+        },
+        "history": [{ "pins": {} }]
+      },
+      "01.2.3": {
+        "pins": { "OTHER": { "description": "Shadowed", "value": 5 } }
+      }
+    }
+  })");
+
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+
+  auto const *revisions = db.find_type("test-board");
+  REQUIRE(revisions != nullptr);
+  REQUIRE(revisions->size() == 1);
+  auto const &pins = *revisions->pins.front();
+  REQUIRE(pins.size() == 1);
+  REQUIRE(pins.name(0) == "LED");
+  REQUIRE(pins.number(0) == 17);
+  REQUIRE(pins.description(0) == "Status LED");
+}
+
+#if defined(__cpp_exceptions)
+TEST_CASE("load_database throws on malformed revision keys", "[lookup]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json",
+                  R"({ "test-board": { "1.2": { "pins": {} } } })");
+
+  REQUIRE_THROWS_AS(er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                              temp.path() / "schema.json"),
+                    std::runtime_error);
+}
+
+TEST_CASE("load_database throws on revisions out of the packed range",
+          "[lookup]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json",
+                  R"({ "test-board": { "65536.0.0": { "pins": {} } } })");
+
+  REQUIRE_THROWS_AS(er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                              temp.path() / "schema.json"),
+                    std::runtime_error);
+}
+#endif
+
+// --- Tests for the non-throwing API ---
+
+TEST_CASE("try_get reports a missing device as no_device", "[try_get]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  const auto result = er::hwinfo::try_get(temp.path() / "nonexistent",
+                                          temp.path() / "hwdb.json",
+                                          temp.path() / "schema.json");
+
+  REQUIRE_FALSE(result);
+  REQUIRE(result.error().code == er::hwinfo::errc::no_device);
+}
+
+TEST_CASE("try_get resolves the pins of the device", "[try_get]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  const auto result = er::hwinfo::try_get(
+      temp.path(), temp.path() / "hwdb.json", temp.path() / "schema.json");
+
+  REQUIRE(result);
+  REQUIRE(result->dev.hw_type == "test-board");
+  REQUIRE(result->pins.size() == 1);
+}
+
+TEST_CASE("try_load_database reports why loading failed",
+          "[try_load_database]") {
+  using er::hwinfo::errc;
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  const auto load = [&](std::string const &hwdb) {
+    write_text_file(temp.path() / "hwdb.json", hwdb);
+    return er::hwinfo::try_load_database(temp.path() / "hwdb.json",
+                                         temp.path() / "schema.json");
+  };
+
+  const auto missing = er::hwinfo::try_load_database(
+      temp.path() / "missing.json", temp.path() / "schema.json");
+  REQUIRE(missing.error().code == errc::file_open_failed);
+  REQUIRE(missing.error().detail == (temp.path() / "missing.json").string());
+
+  const auto malformed = load(R"({ "test-board": )");
+  REQUIRE(malformed.error().code == errc::parse_failed);
+  REQUIRE(malformed.error().offset == 16);
+
+  const auto violation = load(R"({ "test-board": { "1.0.0": {} } })");
+  REQUIRE(violation.error().code == errc::schema_violation);
+  REQUIRE_FALSE(violation.error().detail.empty());
+
+  const auto invalid =
+      load(R"({ "test-board": { "1.x.0": { "pins": {} } } })");
+  REQUIRE(invalid.error().code == errc::invalid_revision);
+  REQUIRE(invalid.error().detail == "1.x.0");
+  REQUIRE(invalid.error().offset == 2);
+  REQUIRE(invalid.error().message() ==
+          "Invalid revision string component: x.0");
+
+  const auto range =
+      load(R"({ "test-board": { "65536.0.0": { "pins": {} } } })");
+  REQUIRE(range.error().code == errc::revision_out_of_range);
+  REQUIRE(range.error().detail == "65536.0.0");
+
+  REQUIRE(load(valid_hwdb));
+}
+
+#if defined(__cpp_exceptions)
+TEST_CASE("load_database throws the message of the error",
+          "[try_load_database]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json",
+                  R"({ "test-board": { "1.2": { "pins": {} } } })");
+
+  const auto error = er::hwinfo::try_load_database(
+      temp.path() / "hwdb.json", temp.path() / "schema.json");
+  REQUIRE_FALSE(error);
+  REQUIRE_THROWS_WITH(er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                                temp.path() / "schema.json"),
+                      error.error().message());
+}
+#endif
+
+// --- Tests for packed revision keys ---
+
+TEST_CASE("pack_revision preserves revision order", "[revision_key]") {
+  using er::hwinfo::revision;
+  using er::hwinfo::impl::pack_revision;
+  const std::vector<revision> ordered{
+      {0, 0, 0},
+      {0, 0, 1},
+      {0, 0, 0xffffff},
+      {0, 1, 0},
+      {0, 0xffffff, 0xffffff},
+      {1, 0, 0},
+      {1, 2, 3},
+      {0xffff, 0, 0},
+      {0xffff, 0xffffff, 0xffffff},
+  };
+  for (std::size_t i = 0; i < ordered.size(); ++i) {
+    const auto key = pack_revision(ordered[i]);
+    REQUIRE(key.has_value());
+    REQUIRE(er::hwinfo::impl::unpack_revision(*key) == ordered[i]);
+    if (i > 0) {
+      REQUIRE(*pack_revision(ordered[i - 1]) < *key);
+    }
+  }
+  REQUIRE_FALSE(pack_revision({0x10000, 0, 0}));
+  REQUIRE_FALSE(pack_revision({0, 0x1000000, 0}));
+  REQUIRE_FALSE(pack_revision({0, 0, 0x1000000}));
+}
+
+TEST_CASE("select_revision_key agrees with select_revision",
+          "[revision_key]") {
+  using er::hwinfo::revision;
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<std::size_t> small(0, 3);
+  for (int round = 0; round < 200; ++round) {
+    std::set<revision> revisions;
+    const auto count = rng() % 20;
+    for (std::size_t i = 0; i < count; ++i) {
+      revisions.insert({small(rng), small(rng), small(rng)});
+    }
+    std::vector<er::hwinfo::impl::revision_key> keys;
+    for (auto const &rev : revisions) {
+      keys.push_back(*er::hwinfo::impl::pack_revision(rev));
+    }
+    const std::vector<revision> sorted(revisions.begin(), revisions.end());
+
+    for (std::size_t major = 0; major <= 4; ++major) {
+      for (std::size_t minor = 0; minor <= 4; ++minor) {
+        for (std::size_t patch = 0; patch <= 4; ++patch) {
+          const revision requested{major, minor, patch};
+          const auto expected = static_cast<std::size_t>(
+              er::hwinfo::impl::select_revision(sorted, requested) -
+              sorted.begin());
+          const auto key = *er::hwinfo::impl::pack_request(requested);
+          REQUIRE(er::hwinfo::impl::select_revision_key(keys, key) ==
+                  expected);
+        }
+      }
+    }
+  }
+}
+
+TEST_CASE("count_less agrees with the scalar reference", "[revision_key]") {
+  INFO("revision search: " << er::hwinfo::impl::revision_search_isa);
+  std::mt19937_64 rng(7);
+  for (std::size_t size = 0; size <= 70; ++size) {
+    std::vector<er::hwinfo::impl::revision_key> keys(size);
+    for (auto &key : keys) {
+      // cover keys with the top bit set, which need the signed bias
+      key = rng() >> (rng() % 2 ? 0 : 16);
+    }
+    std::ranges::sort(keys);
+    for (int probe = 0; probe < 20; ++probe) {
+      const auto key = probe % 2 && size > 0 ? keys[rng() % size] : rng();
+      REQUIRE(er::hwinfo::impl::count_less(keys, key) ==
+              er::hwinfo::impl::count_less_scalar(keys, key));
+    }
+  }
+}
+
+TEST_CASE("lower_bound_key agrees with std::lower_bound", "[revision_key]") {
+  std::mt19937_64 rng(11);
+  for (const std::size_t size : {0, 1, 31, 32, 33, 100, 257, 1000}) {
+    std::vector<er::hwinfo::impl::revision_key> keys(size);
+    for (auto &key : keys) {
+      key = rng() % 5000;
+    }
+    std::ranges::sort(keys);
+    for (er::hwinfo::impl::revision_key key = 0; key <= 5001; key += 7) {
+      const auto expected = static_cast<std::size_t>(
+          std::ranges::lower_bound(keys, key) - keys.begin());
+      REQUIRE(er::hwinfo::impl::lower_bound_key(keys, key) == expected);
+    }
+  }
+  static_assert(er::hwinfo::impl::lower_bound_key({}, 1) == 0);
+}
+
+TEST_CASE("revision_list clamps requests beyond the packed range",
+          "[revision_key]") {
+  er::hwinfo::impl::revision_list list;
+  for (const er::hwinfo::revision rev :
+       {er::hwinfo::revision{1, 0, 0}, {1, 0, 0xffffff}, {1, 1, 0},
+        {1, 0xffffff, 0xffffff}, {2, 0, 0}}) {
+    list.keys.push_back(*er::hwinfo::impl::pack_revision(rev));
+    list.pins.emplace_back();
+  }
+
+  REQUIRE(list.select({1, 0x1000000, 0}) == 3);
+  // The first revision >= 1.0.0x1000000 is 1.1.0, not 1.0.0xffffff
+  REQUIRE(list.select({1, 0, 0x1000000}) == 2);
+  REQUIRE(list.select({1, 0xffffff, 0x1000000}) == 3);
+  REQUIRE(list.select({2, 5, 0x1000000}) == 4);
+  REQUIRE(list.select({0x10000, 0, 0}) == list.size());
+
+  // Without 1.1.0, the next same-major revision is 1.0xffffff.0xffffff
+  list.keys.erase(list.keys.begin() + 2);
+  list.pins.erase(list.pins.begin() + 2);
+  REQUIRE(list.select({1, 0, 0x1000000}) == 2);
+  REQUIRE(list.select({1, 5, 0x1000000}) == 2);
+}
+
+// --- Tests for er::hwinfo::database_handle ---
+
+TEST_CASE("database_handle serves lookups while reloads are published",
+          "[database_handle]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "v1.json", R"({
+    "test-board": {
+      "1.0.0": { "pins": { "V1_PIN": { "description": "v1", "value": 10 } } }
+    }
+  })");
+  write_text_file(temp.path() / "v2.json", R"({
+    "test-board": {
+      "1.0.0": { "pins": { "V2_PIN": { "description": "v2", "value": 20 } } }
+    }
+  })");
+  const er::hwinfo::device dev{"test-board", {1, 0, 0}};
+  er::hwinfo::database_handle hwdb(er::hwinfo::load_database(
+      temp.path() / "v1.json", temp.path() / "schema.json"));
+
+  REQUIRE(hwdb.lookup(dev).pins.begin()->name == "V1_PIN");
+
+  std::atomic<bool> done{false};
+  std::atomic<std::size_t> bad{0};
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back([&] {
+      while (!done) {
+        auto const pins = hwdb.lookup(dev).pins;
+        if (pins.size() != 1 || (pins.begin()->name != "V1_PIN" &&
+                                 pins.begin()->name != "V2_PIN")) {
+          ++bad;
+        }
+      }
+    });
+  }
+  for (int i = 0; i < 20; ++i) {
+    hwdb.reload(temp.path() / (i % 2 ? "v1.json" : "v2.json"),
+                temp.path() / "schema.json");
+  }
+  done = true;
+  for (auto &reader : readers) {
+    reader.join();
+  }
+
+  REQUIRE(bad == 0);
+  REQUIRE(hwdb.lookup(dev).pins.begin()->name == "V1_PIN");
+}
+
+TEST_CASE("database_handle keeps the current snapshot when reload fails",
+          "[database_handle]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  er::hwinfo::database_handle hwdb(er::hwinfo::load_database(
+      temp.path() / "hwdb.json", temp.path() / "schema.json"));
+
+#if defined(__cpp_exceptions)
+  REQUIRE_THROWS_AS(hwdb.reload(temp.path() / "missing.json",
+                                temp.path() / "schema.json"),
+                    std::runtime_error);
+#endif
+  const auto reloaded = hwdb.try_reload(temp.path() / "missing.json",
+                                        temp.path() / "schema.json");
+  REQUIRE_FALSE(reloaded);
+  REQUIRE(reloaded.error().code == er::hwinfo::errc::file_open_failed);
+  REQUIRE(hwdb.lookup({"test-board", {1, 2, 3}}).pins.size() == 1);
+}
+
+// --- Tests for the perfect hash and embedded databases ---
+
+TEST_CASE("build_perfect_hash assigns every name its own slot",
+          "[perfect_hash]") {
+  std::vector<std::string> names;
+  for (int i = 0; i < 500; ++i) {
+    names.push_back(fmt::format("GPIO_PIN_{}", i));
+  }
+  const std::vector<std::string_view> views(names.begin(), names.end());
+
+  const auto hash = er::hwinfo::impl::build_perfect_hash(views);
+
+  REQUIRE(hash.has_value());
+  std::vector<er::hwinfo::embedded_pin> slots(names.size());
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    REQUIRE(slots[hash->slots[i]].name.empty());
+    slots[hash->slots[i]] = {views[i], static_cast<std::uint8_t>(i % 256), ""};
+  }
+  const er::hwinfo::embedded_pin_map map{slots, hash->seeds};
+  for (std::size_t i = 0; i < names.size(); ++i) {
+    auto const *pin = map.find(names[i]);
+    REQUIRE(pin != nullptr);
+    REQUIRE(pin->number == i % 256);
+  }
+  REQUIRE(map.find("GPIO_PIN_500") == nullptr);
+  REQUIRE(map.find("") == nullptr);
+}
+
+TEST_CASE("build_perfect_hash fails on duplicate names", "[perfect_hash]") {
+  const std::vector<std::string_view> names{"LED", "BUTTON", "LED"};
+
+  REQUIRE_FALSE(er::hwinfo::impl::build_perfect_hash(names, 1000));
+}
+
+#if defined(ER_HWINFO_TEST_EMBEDDED)
+TEST_CASE("find_pins on the embedded hwdb agrees with lookup", "[embedded]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  auto const db = er::hwinfo::load_database(resources / "hwdb.json",
+                                            resources / "hwdb-schema.json");
+
+  for (auto const &type : er::hwinfo::generated::hwdb) {
+    for (auto const &entry : type.revisions) {
+      for (const auto rev :
+           {entry.rev, er::hwinfo::revision{entry.rev.major, 99, 0},
+            er::hwinfo::revision{entry.rev.major + 100, 0, 0}}) {
+        const er::hwinfo::device dev{er::hwinfo::type_name_string(type.name),
+                                     rev};
+        const auto expected = er::hwinfo::lookup(dev, db).pins;
+        auto const *pins = er::hwinfo::find_pins(dev, er::hwinfo::generated::hwdb);
+
+        REQUIRE((pins != nullptr) == !expected.empty());
+        if (!pins) {
+          continue;
+        }
+        REQUIRE(pins->pins.size() == expected.size());
+        for (auto const &pin : expected) {
+          auto const *found = pins->find(pin.name);
+          REQUIRE(found != nullptr);
+          REQUIRE(found->number == pin.number);
+          REQUIRE(found->description == pin.description);
+        }
+        REQUIRE(pins->find("NO_SUCH_PIN") == nullptr);
+        REQUIRE(pins->to_pin_set().size() == expected.size());
+      }
+    }
+  }
+  REQUIRE(er::hwinfo::find_pins({"no-such-board", {1, 0, 0}},
+                                er::hwinfo::generated::hwdb) == nullptr);
+}
+#endif
+
+// --- Tests for er::hwinfo::impl::compiled_validator ---
+
+namespace {
+
+std::string read_text_file(const std::filesystem::path &path) {
+  std::ifstream file(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(file),
+          std::istreambuf_iterator<char>()};
+}
+
+std::string pin_hwdb(const std::string &pin) {
+  return R"({ "board": { "1.0.0": { "pins": { "PIN": )" + pin + " } } } }";
+}
+
+} // namespace
+
+TEST_CASE("compiled_validator agrees with SchemaValidator",
+          "[compiled_validator]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  rapidjson::Document schema_doc;
+  schema_doc.Parse(read_text_file(resources / "hwdb-schema.json").c_str());
+  REQUIRE_FALSE(schema_doc.HasParseError());
+  const rapidjson::SchemaDocument schema(schema_doc);
+
+  const std::string long_description(257, 'd');
+  struct sample {
+    std::string json;
+    bool valid;
+    /// constrained by propertyNames or pattern
+    bool key_constraint;
+  };
+  const std::vector<sample> samples{
+      {valid_hwdb, true, false},
+      {read_text_file(resources / "hwdb.json"), true, false},
+      {"{}", true, false},
+      {R"({ "board": {} })", true, false},
+      {R"({ "board": { "1.0.0": { "pins": {} } } })", true, false},
+      {pin_hwdb(R"({ "value": 0, "description": "" })"), true, false},
+      {pin_hwdb(R"({ "description": "x", "value": 255 })"), true, false},
+      {pin_hwdb(fmt::format(R"({{ "description": "{}", "value": 1 }})",
+                            long_description.substr(1))),
+       true, false},
+      {"[]", false, false},
+      {R"({ "board": [] })", false, false},
+      {R"({ "board": { "1.0.0": {} } })", false, false},
+      {R"({ "board": { "1.0.0": { "pins": [] } } })", false, false},
+      {R"({ "board": { "1.0.0": { "pins": {}, "extra": 1 } } })", false,
+       false},
+      {pin_hwdb(R"("LED")"), false, false},
+      {pin_hwdb(R"({ "description": "x" })"), false, false},
+      {pin_hwdb(R"({ "value": 1 })"), false, false},
+      {pin_hwdb(R"({ "description": "x", "value": 1, "extra": [] })"),
+       false, false},
+      {pin_hwdb(R"({ "description": 1, "value": 1 })"), false, false},
+      {pin_hwdb(R"({ "description": "x", "value": "1" })"), false, false},
+      {pin_hwdb(R"({ "description": "x", "value": 1.5 })"), false, false},
+      {pin_hwdb(R"({ "description": "x", "value": -1 })"), false, false},
+      {pin_hwdb(R"({ "description": "x", "value": 256 })"), false, false},
+      {pin_hwdb(fmt::format(R"({{ "description": "{}", "value": 1 }})",
+                            long_description)),
+       false, false},
+      {fmt::format(R"({{ "{}": {{}} }})", std::string(64, 't')), true, true},
+      {fmt::format(R"({{ "{}": {{}} }})", std::string(65, 't')), false, true},
+      {fmt::format(R"({{ "b": {{ "{}1.0.0": {{ "pins": {{}} }} }} }})",
+                   std::string(27, '0')),
+       true, true},
+      {fmt::format(R"({{ "b": {{ "{}1.0.0": {{ "pins": {{}} }} }} }})",
+                   std::string(28, '0')),
+       false, true},
+      {R"({ "b": { "1.2": { "pins": {} } } })", false, true},
+      {R"({ "b": { "1.2.3.4": { "pins": {} } } })", false, true},
+      {R"({ "b": { "1..2": { "pins": {} } } })", false, true},
+      {R"({ "b": { "a.b.c": { "pins": {} } } })", false, true},
+      {fmt::format(R"({{ "b": {{ "1.0.0": {{ "pins": {{ "{}": )"
+                   R"({{ "description": "", "value": 1 }} }} }} }} }})",
+                   std::string(65, 'p')),
+       false, true},
+      {R"({ "b": { "1.1.0": { "base": "1.0.0", "remove": ["LED"],
+                              "pins": {} } } })",
+       true, false},
+      {R"({ "b": { "1.1.0": { "remove": [], "pins": {} } } })", true, false},
+      {R"({ "b": { "1.1.0": { "base": "1.0.0" } } })", false, false},
+      {R"({ "b": { "1.1.0": { "base": 1, "pins": {} } } })", false, false},
+      {R"({ "b": { "1.1.0": { "base": "1.0", "pins": {} } } })", false,
+       true},
+      {R"({ "b": { "1.1.0": { "remove": "LED", "pins": {} } } })", false,
+       false},
+      {R"({ "b": { "1.1.0": { "remove": [1], "pins": {} } } })", false,
+       false},
+      {R"({ "b": { "1.1.0": { "remove": [[]], "pins": {} } } })", false,
+       false},
+      {R"({ "b": { "1.1.0": { "remove": [{}], "pins": {} } } })", false,
+       false},
+      {fmt::format(R"({{ "b": {{ "1.1.0": {{ "remove": ["{}"], )"
+                   R"("pins": {{}} }} }} }})",
+                   std::string(65, 'p')),
+       false, false},
+  };
+
+  for (auto const &[json, valid, key_constraint] : samples) {
+    INFO(json);
+    rapidjson::Document doc;
+    doc.Parse(json.c_str());
+    REQUIRE_FALSE(doc.HasParseError());
+
+    er::hwinfo::impl::compiled_validator<er::hwinfo::generated::hwdb_schema>
+        compiled;
+    REQUIRE(doc.Accept(compiled) == valid);
+    REQUIRE(compiled.IsValid() == valid);
+    REQUIRE((compiled.invalid_keyword() == nullptr) == valid);
+    // propertyNames and pattern are not implemented by every RapidJSON
+    // release, so these constraints are only checked against the expected
+    // result
+    if (!key_constraint) {
+      rapidjson::SchemaValidator generic(schema);
+      REQUIRE(doc.Accept(generic) == valid);
+    }
+  }
+}
+
+TEST_CASE("compiled_validator forwards events of valid documents",
+          "[compiled_validator]") {
+  struct event_counter
+      : rapidjson::BaseReaderHandler<rapidjson::UTF8<>, event_counter> {
+    std::size_t events = 0;
+    bool Default() {
+      ++events;
+      return true;
+    }
+  };
+  rapidjson::Document doc;
+  doc.Parse(valid_hwdb.c_str());
+  event_counter direct;
+  event_counter forwarded;
+  er::hwinfo::impl::compiled_validator<er::hwinfo::generated::hwdb_schema,
+                                       event_counter>
+      validator(forwarded);
+
+  REQUIRE(doc.Accept(direct));
+  REQUIRE(doc.Accept(validator));
+  REQUIRE(forwarded.events == direct.events);
+}
+
+TEST_CASE("load_database validates against the built-in schema",
+          "[compiled_validator]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  auto const builtin = er::hwinfo::load_database(resources / "hwdb.json",
+                                                 er::hwinfo::builtin_schema);
+  auto const generic = er::hwinfo::load_database(
+      resources / "hwdb.json", resources / "hwdb-schema.json");
+  REQUIRE(builtin.types().size() == generic.types().size());
+  for (auto const &[name, revisions] : generic.types()) {
+    auto const *found = builtin.find_type(name);
+    REQUIRE(found != nullptr);
+    REQUIRE(found->size() == revisions.size());
+  }
+
+  TempDir temp;
+  write_text_file(temp.path() / "hwdb.json",
+                  pin_hwdb(R"({ "description": "x", "value": 256 })"));
+  const auto rejected = er::hwinfo::try_load_database(
+      temp.path() / "hwdb.json", er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(rejected);
+  REQUIRE(rejected.error().code == er::hwinfo::errc::schema_violation);
+  REQUIRE(rejected.error().detail.ends_with("/properties/value"));
+}
+
 // --- Tests for er::hwinfo::impl::extract_revision ---
 
 TEST_CASE("extract_revision parses valid revision string",
@@ -708,6 +1446,7 @@ TEST_CASE("extract_revision parses zero version numbers",
   REQUIRE(rev.patch == 0);
 }
 
+#if defined(__cpp_exceptions)
 TEST_CASE("extract_revision throws on empty string", "[extract_revision]") {
   REQUIRE_THROWS_AS(er::hwinfo::impl::extract_revision(""), std::runtime_error);
 }
@@ -751,53 +1490,1534 @@ TEST_CASE("extract_revision throws on non-numeric patch",
   REQUIRE_THROWS_AS(er::hwinfo::impl::extract_revision("1.2.c"),
                     std::runtime_error);
 }
+#endif
 
-// --- Tests for er::hwinfo::pin_set transparent lookup ---
-
-TEST_CASE("pin_set supports transparent lookup by name", "[pin_set]") {
-  er::hwinfo::pin_set pins;
-  pins.insert({.name = "LED", .number = 17, .description = "Status LED"});
-  pins.insert({.name = "BUTTON", .number = 27, .description = "User button"});
-  pins.insert({.name = "RELAY", .number = 22, .description = "Power relay"});
+// --- Tests for er::hwinfo::impl::parse_revision ---
 
-  SECTION("find by string_view returns correct pin") {
-    auto it = pins.find(std::string_view("BUTTON"));
-    REQUIRE(it != pins.end());
-    REQUIRE(it->name == "BUTTON");
-    REQUIRE(it->number == 27);
-  }
+namespace {
 
-  SECTION("find by string returns correct pin") {
-    std::string name = "RELAY";
-    auto it = pins.find(name);
-    REQUIRE(it != pins.end());
-    REQUIRE(it->name == "RELAY");
-    REQUIRE(it->number == 22);
-  }
+bool same_result(er::hwinfo::impl::revision_parse_result const &a,
+                 er::hwinfo::impl::revision_parse_result const &b) {
+  return a.ec == b.ec && a.offset == b.offset &&
+         (a.ec != std::errc() || a.rev == b.rev);
+}
 
-  SECTION("find by string literal returns correct pin") {
-    auto it = pins.find("LED");
-    REQUIRE(it != pins.end());
-    REQUIRE(it->name == "LED");
-    REQUIRE(it->number == 17);
+/// The from_chars based parser parse_revision() replaced, as a baseline
+er::hwinfo::revision from_chars_revision(std::string_view text) {
+  er::hwinfo::revision rev;
+  const char *first = text.data();
+  const char *const last = text.data() + text.size();
+  for (auto *component : {&rev.major, &rev.minor, &rev.patch}) {
+    const auto res = std::from_chars(first, last, *component);
+    if (res.ec != std::errc()) {
+      return {};
+    }
+    first = res.ptr + (res.ptr == last ? 0 : 1);
   }
+  return rev;
+}
 
-  SECTION("find returns end for non-existent name") {
-    auto it = pins.find("NONEXISTENT");
-    REQUIRE(it == pins.end());
-  }
+} // namespace
 
-  SECTION("contains by name works correctly") {
-    REQUIRE(pins.contains("LED"));
-    REQUIRE(pins.contains("BUTTON"));
-    REQUIRE_FALSE(pins.contains("MISSING"));
+TEST_CASE("parse_revision agrees with the scalar parser",
+          "[parse_revision]") {
+  // every string of up to 9 characters over a small alphabet
+  constexpr std::string_view alphabet = "07.x";
+  std::size_t mismatches = 0;
+  std::string first_mismatch;
+  std::string text;
+  for (std::size_t length = 0; length <= 9; ++length) {
+    text.assign(length, alphabet[0]);
+    for (;;) {
+      if (!same_result(er::hwinfo::impl::parse_revision(text),
+                       er::hwinfo::impl::parse_revision_scalar(text))) {
+        first_mismatch = mismatches++ ? first_mismatch : text;
+      }
+      std::size_t i = 0;
+      for (; i < length; ++i) {
+        const auto next = alphabet.find(text[i]) + 1;
+        if (next < alphabet.size()) {
+          text[i] = alphabet[next];
+          break;
+        }
+        text[i] = alphabet[0];
+      }
+      if (i == length) {
+        break;
+      }
+    }
   }
+  INFO("first mismatch: " << first_mismatch);
+  REQUIRE(mismatches == 0);
 }
 
-// --- Integration tests for er-hwinfo CLI ---
+TEST_CASE("parse_revision reports errors without throwing",
+          "[parse_revision]") {
+  using er::hwinfo::impl::parse_revision;
+  static_assert(parse_revision("1.2.3").rev == er::hwinfo::revision{1, 2, 3});
 
-namespace {
-struct cli_result {
+  REQUIRE(parse_revision("12.34.56").rev == er::hwinfo::revision{12, 34, 56});
+  REQUIRE(parse_revision("100.200.300").rev ==
+          er::hwinfo::revision{100, 200, 300});
+
+  const auto missing_patch = parse_revision("1.2");
+  REQUIRE(missing_patch.ec == std::errc::invalid_argument);
+  REQUIRE(missing_patch.offset == 2);
+
+  const auto bad_minor = parse_revision("1.x.3");
+  REQUIRE(bad_minor.ec == std::errc::invalid_argument);
+  REQUIRE(bad_minor.offset == 2);
+
+  const auto overflow = parse_revision("1.99999999999999999999999.3");
+  REQUIRE(overflow.ec == std::errc::result_out_of_range);
+  REQUIRE(overflow.offset == 2);
+
+  REQUIRE(parse_revision("1.2.3 ").ec == std::errc::invalid_argument);
+  REQUIRE(parse_revision("+1.2.3").ec == std::errc::invalid_argument);
+}
+
+TEST_CASE("parse_revision benchmark", "[!benchmark][parse_revision]") {
+  std::mt19937 rng(3);
+  std::vector<std::string> keys;
+  for (int i = 0; i < 10000; ++i) {
+    keys.push_back(fmt::format("{}.{}.{}", rng() % 20, rng() % 50,
+                               rng() % (i % 4 ? 10 : 1000)));
+  }
+
+  BENCHMARK("std::from_chars") {
+    std::size_t sum = 0;
+    for (auto const &key : keys) {
+      sum += from_chars_revision(key).patch;
+    }
+    return sum;
+  };
+  BENCHMARK("parse_revision") {
+    std::size_t sum = 0;
+    for (auto const &key : keys) {
+      sum += er::hwinfo::impl::parse_revision(key).rev.patch;
+    }
+    return sum;
+  };
+}
+
+// --- Tests for er::hwinfo::pin_map ---
+
+TEST_CASE("pin_map keeps pins sorted by name", "[pin_map]") {
+  std::vector<er::hwinfo::pin> pins{
+      {"MOTOR", 5, "Motor driver"},
+      {"LED", 17, "Status LED"},
+      {"BUTTON", 4, "User button"},
+      {"LED", 18, "Shadowed"},
+  };
+  const er::hwinfo::pin_map map(pins);
+
+  REQUIRE(map.size() == 3);
+  REQUIRE(map.name(0) == "BUTTON");
+  REQUIRE(map.name(1) == "LED");
+  REQUIRE(map.name(2) == "MOTOR");
+  REQUIRE(map.number(1) == 17);
+  REQUIRE(map.description(1) == "Status LED");
+
+  REQUIRE(map.find("MOTOR") == 2);
+  REQUIRE(map.find("BUTTON") == 0);
+  REQUIRE(map.find("A") == map.size());
+  REQUIRE(map.find("LEDS") == map.size());
+  REQUIRE(map.find("Z") == map.size());
+  REQUIRE(er::hwinfo::pin_map().find("LED") == 0);
+
+  auto const set = map.to_pin_set();
+  REQUIRE(set.size() == 3);
+  REQUIRE(set.find("MOTOR")->description == "Motor driver");
+  REQUIRE(map.at(0).number == 4);
+}
+
+TEST_CASE("find_pins on a loaded database agrees with lookup",
+          "[pin_map]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+
+  auto const *pins = er::hwinfo::find_pins({"test-board", {1, 2, 0}}, db);
+  REQUIRE(pins != nullptr);
+  REQUIRE(pins->size() == 1);
+  const auto led = pins->find("LED");
+  REQUIRE(led < pins->size());
+  REQUIRE(pins->number(led) == 17);
+  REQUIRE(er::hwinfo::find_pins({"test-board", {2, 0, 0}}, db) == nullptr);
+  REQUIRE(er::hwinfo::find_pins({"other-board", {1, 2, 3}}, db) == nullptr);
+}
+
+TEST_CASE("load_database rejects GPIO numbers above 255", "[pin_map]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json",
+                  pin_hwdb(R"({ "description": "x", "value": 256 })"));
+
+  const auto db = er::hwinfo::try_load_database(temp.path() / "hwdb.json",
+                                                temp.path() / "schema.json");
+  REQUIRE_FALSE(db);
+  REQUIRE(db.error().code == er::hwinfo::errc::gpio_out_of_range);
+  REQUIRE(db.error().detail == "PIN");
+}
+
+TEST_CASE("revisions with identical pins share one pin_map", "[pin_map]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", R"({
+    "board-a": {
+      "1.0.0": { "pins": { "LED": { "description": "Status", "value": 1 },
+                           "KEY": { "description": "Button", "value": 2 } } },
+      "1.1.0": { "pins": { "KEY": { "description": "Button", "value": 2 },
+                           "LED": { "description": "Status", "value": 1 } } },
+      "1.2.0": { "pins": { "LED": { "description": "Status", "value": 3 } } }
+    },
+    "board-b": {
+      "1.0.0": { "pins": { "LED": { "description": "Status", "value": 3 } } }
+    }
+  })");
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+
+  auto const &a = db.find_type("board-a")->pins;
+  auto const &b = db.find_type("board-b")->pins;
+  REQUIRE(a[0] == a[1]);
+  REQUIRE(a[1] != a[2]);
+  REQUIRE(a[2] == b[0]);
+  // descriptions are interned across distinct maps
+  REQUIRE(a[0]->description(a[0]->find("LED")).data() ==
+          a[2]->description(0).data());
+
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  auto const shipped = er::hwinfo::load_database(resources / "hwdb.json",
+                                                 er::hwinfo::builtin_schema);
+  auto const *mrcm = shipped.find_type("mrcm");
+  REQUIRE(mrcm != nullptr);
+  REQUIRE(mrcm->pins[mrcm->select({0, 5, 0})] ==
+          mrcm->pins[mrcm->select({1, 0, 0})]);
+}
+
+// --- Tests for revision inheritance ---
+
+TEST_CASE("revisions inherit the pins of their base", "[inheritance]") {
+  TempDir temp;
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  write_text_file(temp.path() / "hwdb.json", R"({
+    "board": {
+      "1.2.0": { "base": "1.1.0", "remove": ["KEY"],
+                 "pins": { "BEEP": { "description": "Buzzer", "value": 5 } } },
+      "1.0.0": { "pins": { "LED": { "description": "Status", "value": 1 },
+                           "KEY": { "description": "Button", "value": 2 },
+                           "FAN": { "description": "Fan", "value": 3 } } },
+      "1.1.0": { "base": "1.0.0", "remove": ["FAN", "NONE"],
+                 "pins": { "LED": { "description": "Power", "value": 4 } } },
+      "2.0.0": { "base": "01.0.0",
+                 "pins": { "LED": { "description": "Status", "value": 1 },
+                           "KEY": { "description": "Button", "value": 2 },
+                           "FAN": { "description": "Fan", "value": 3 } } }
+    }
+  })");
+
+  for (auto const &db :
+       {er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                  er::hwinfo::builtin_schema),
+        er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                  resources / "hwdb-schema.json")}) {
+    auto const *board = db.find_type("board");
+    REQUIRE(board != nullptr);
+    auto const &v110 = *board->pins[board->select({1, 1, 0})];
+    REQUIRE(v110.size() == 2);
+    REQUIRE(v110.number(v110.find("LED")) == 4);
+    REQUIRE(v110.description(v110.find("LED")) == "Power");
+    REQUIRE(v110.number(v110.find("KEY")) == 2);
+
+    auto const &v120 = *board->pins[board->select({1, 2, 0})];
+    REQUIRE(v120.size() == 2);
+    REQUIRE(v120.number(v120.find("LED")) == 4);
+    REQUIRE(v120.number(v120.find("BEEP")) == 5);
+    REQUIRE(v120.find("KEY") == v120.size());
+
+    // overriding every inherited pin unchanged shares the base's map
+    REQUIRE(board->pins[board->select({2, 0, 0})] ==
+            board->pins[board->select({1, 0, 0})]);
+  }
+}
+
+TEST_CASE("load_database rejects unknown and circular bases",
+          "[inheritance]") {
+  TempDir temp;
+  const auto rejected = [&](std::string const &json) {
+    write_text_file(temp.path() / "hwdb.json", json);
+    auto db = er::hwinfo::try_load_database(temp.path() / "hwdb.json",
+                                            er::hwinfo::builtin_schema);
+    REQUIRE_FALSE(db);
+    return db.error();
+  };
+
+  auto err = rejected(
+      R"({ "board": { "1.1.0": { "base": "1.0.0", "pins": {} } } })");
+  REQUIRE(err.code == er::hwinfo::errc::invalid_base);
+  REQUIRE(err.detail == "board 1.1.0");
+  REQUIRE(err.message() ==
+          "Unknown or circular base revision of board 1.1.0");
+
+  err = rejected(R"({ "board": {
+    "1.0.0": { "pins": {} },
+    "1.1.0": { "base": "1.2.0", "pins": {} },
+    "1.2.0": { "base": "1.1.0", "pins": {} } } })");
+  REQUIRE(err.code == er::hwinfo::errc::invalid_base);
+  REQUIRE(err.detail == "board 1.1.0");
+
+  err = rejected(
+      R"({ "board": { "1.0.0": { "base": "1.0.0", "pins": {} } } })");
+  REQUIRE(err.code == er::hwinfo::errc::invalid_base);
+
+  err = rejected(R"({ "board": { "1.0.0": { "pins": {} },
+    "1.1.0": { "base": "1.0.16777216", "pins": {} } } })");
+  REQUIRE(err.code == er::hwinfo::errc::revision_out_of_range);
+}
+
+// --- Tests for hwdb.d fragment directories ---
+
+namespace {
+
+/// hwdb.d with a valid fragment of board-a and a corrupt one of board-b,
+/// which only loads that touch board-b can notice
+void create_fragment_dir(std::filesystem::path const &dir) {
+  std::filesystem::create_directories(dir);
+  write_text_file(dir / "manifest.json", R"(["board-a", "board-b"])");
+  write_text_file(dir / "board-a.json", R"({
+    "board-a": {
+      "1.0.0": { "pins": { "LED": { "description": "Status", "value": 17 } } }
+    }
+  })");
+  write_text_file(dir / "board-b.json", "{ not json");
+}
+
+} // namespace
+
+TEST_CASE("load_type reads only the fragment of the type", "[fragments]") {
+  TempDir temp;
+  const auto dir = temp.path() / "hwdb.d";
+  create_fragment_dir(dir);
+
+  auto const db = er::hwinfo::load_type(dir, "board-a",
+                                        er::hwinfo::builtin_schema);
+  auto const *pins = er::hwinfo::find_pins({"board-a", {1, 0, 0}}, db);
+  REQUIRE(pins != nullptr);
+  REQUIRE(pins->number(pins->find("LED")) == 17);
+
+  // types without a fragment, or whose name cannot be one, are unknown
+  for (auto const *type : {"board-c", "../hwdb.d/board-a", "manifest", ""}) {
+    INFO(type);
+    auto const other = er::hwinfo::try_load_type(dir, type,
+                                                 er::hwinfo::builtin_schema);
+    REQUIRE(other);
+    REQUIRE(other->types().empty());
+  }
+
+  auto const corrupt = er::hwinfo::try_load_type(dir, "board-b",
+                                                 er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(corrupt);
+  REQUIRE(corrupt.error().code == er::hwinfo::errc::parse_failed);
+}
+
+TEST_CASE("get resolves pins from a fragment directory", "[fragments]") {
+  TempDir temp;
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  const auto dir = temp.path() / "hwdb.d";
+  create_fragment_dir(dir);
+  create_device_tree(temp.path() / "dt", "board-a", 1, 0, 0);
+
+  auto const info = er::hwinfo::get(temp.path() / "dt", dir,
+                                    resources / "hwdb-schema.json");
+  REQUIRE(info);
+  REQUIRE(info->pins.size() == 1);
+  REQUIRE(info->pins.find("LED")->number == 17);
+}
+
+TEST_CASE("get reads the fragment of a NUL-terminated device type",
+          "[fragments]") {
+  TempDir temp;
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  const auto dir = temp.path() / "hwdb.d";
+  create_fragment_dir(dir);
+  // As on real hardware; board-b.json is corrupt, so only the fragment of
+  // board-a may be read
+  create_device_tree(temp.path() / "dt", std::string("board-a\0", 8), 1, 0,
+                     0);
+
+  auto const info = er::hwinfo::get(temp.path() / "dt", dir,
+                                    resources / "hwdb-schema.json");
+  REQUIRE(info);
+  REQUIRE(info->pins.size() == 1);
+  REQUIRE(info->pins.find("LED")->number == 17);
+
+  auto const dev = er::hwinfo::read_device(temp.path() / "dt");
+  REQUIRE(dev);
+  auto const db = er::hwinfo::load_type(dir, dev->hw_type,
+                                        er::hwinfo::builtin_schema);
+  REQUIRE(db.types().size() == 1);
+  REQUIRE(er::hwinfo::find_pins(*dev, db) != nullptr);
+}
+
+TEST_CASE("load_database loads every fragment of the manifest",
+          "[fragments]") {
+  TempDir temp;
+  const auto dir = temp.path() / "hwdb.d";
+  create_fragment_dir(dir);
+
+  auto const corrupt =
+      er::hwinfo::try_load_database(dir, er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(corrupt);
+  REQUIRE(corrupt.error().code == er::hwinfo::errc::parse_failed);
+
+  write_text_file(dir / "manifest.json", R"(["board-a"])");
+  auto const db = er::hwinfo::load_database(dir, er::hwinfo::builtin_schema);
+  REQUIRE(db.types().size() == 1);
+  REQUIRE(db.find_type("board-a") != nullptr);
+
+  for (auto const *manifest : {R"({})", R"([1])", R"(["../board-a"])"}) {
+    INFO(manifest);
+    write_text_file(dir / "manifest.json", manifest);
+    auto const invalid =
+        er::hwinfo::try_load_database(dir, er::hwinfo::builtin_schema);
+    REQUIRE_FALSE(invalid);
+    REQUIRE(invalid.error().code == er::hwinfo::errc::invalid_manifest);
+    REQUIRE(invalid.error().detail == (dir / "manifest.json").string());
+  }
+
+  std::filesystem::remove(dir / "manifest.json");
+  auto const missing =
+      er::hwinfo::try_load_database(dir, er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(missing);
+  REQUIRE(missing.error().code == er::hwinfo::errc::file_open_failed);
+}
+
+TEST_CASE("the generated hwdb.d matches the shipped hwdb", "[fragments]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  auto const whole = er::hwinfo::load_database(resources / "hwdb.json",
+                                               er::hwinfo::builtin_schema);
+  auto const split = er::hwinfo::load_database(ER_HWINFO_FRAGMENT_DIR,
+                                               er::hwinfo::builtin_schema);
+  REQUIRE(split.types().size() == whole.types().size());
+  for (auto const &[name, revisions] : whole.types()) {
+    INFO(name);
+    auto const *found = split.find_type(name);
+    REQUIRE(found != nullptr);
+    REQUIRE(found->keys == revisions.keys);
+    for (std::size_t i = 0; i < revisions.size(); ++i) {
+      REQUIRE(*found->pins[i] == *revisions.pins[i]);
+    }
+  }
+}
+
+// --- Tests for the offset index of hwdb.json ---
+
+namespace {
+
+const std::string indexed_hwdb = R"({
+  "board-a": {
+    "1.0.0": { "pins": { "LED": { "description": "Status", "value": 17 } } }
+  },
+  /* "board-b": { */
+  "board-\"b\\": {
+    "1.0.0": { "pins": { "KEY": { "description": "Button", "value": 4 } } }
+  }
+})";
+
+} // namespace
+
+TEST_CASE("load_type reads only the indexed type", "[offset_index]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, indexed_hwdb);
+  REQUIRE(er::hwinfo::try_write_offset_index(hwdb));
+  REQUIRE(std::filesystem::exists(temp.path() / "hwdb.json.idx"));
+
+  for (auto const *type : {"board-a", "board-\"b\\"}) {
+    INFO(type);
+    auto const db =
+        er::hwinfo::load_type(hwdb, type, er::hwinfo::builtin_schema);
+    REQUIRE(db.types().size() == 1);
+    const er::hwinfo::device dev{
+        er::hwinfo::type_name_string(std::string_view(type)), {1, 0, 0}};
+    REQUIRE(er::hwinfo::find_pins(dev, db) != nullptr);
+  }
+  auto const unknown =
+      er::hwinfo::load_type(hwdb, "board-c", er::hwinfo::builtin_schema);
+  REQUIRE(unknown.types().empty());
+}
+
+TEST_CASE("get reads the indexed slice of a NUL-terminated device type",
+          "[offset_index]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, indexed_hwdb);
+  er::hwinfo::write_offset_index(hwdb);
+  // Corrupt the other type, keeping the index up to date, so that only
+  // reading the slice of board-a can succeed
+  const auto mtime = std::filesystem::last_write_time(hwdb);
+  auto corrupt = indexed_hwdb;
+  corrupt.replace(corrupt.find("\"value\": 4"), 10, "\"value\": [");
+  write_text_file(hwdb, corrupt);
+  std::filesystem::last_write_time(hwdb, mtime);
+  // As on real hardware
+  create_device_tree(temp.path() / "dt", std::string("board-a\0", 8), 1, 0,
+                     0);
+
+  const auto schema =
+      std::filesystem::path(ER_HWINFO_RESOURCE_DIR) / "hwdb-schema.json";
+  auto const info = er::hwinfo::try_get(temp.path() / "dt", hwdb, schema);
+  REQUIRE(info);
+  REQUIRE(info->pins.size() == 1);
+  REQUIRE(info->pins.find("LED")->number == 17);
+  REQUIRE_FALSE(er::hwinfo::try_load_database(hwdb, schema));
+}
+
+TEST_CASE("load_type parses the whole file if its index is stale",
+          "[offset_index]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, indexed_hwdb);
+  er::hwinfo::write_offset_index(hwdb);
+  const auto mtime = std::filesystem::last_write_time(hwdb);
+
+  SECTION("size changed") { write_text_file(hwdb, indexed_hwdb + "\n"); }
+  SECTION("modification time changed") {
+    std::filesystem::last_write_time(hwdb, mtime + std::chrono::seconds(1));
+  }
+  SECTION("contents of the slice changed") {
+    auto changed = indexed_hwdb;
+    changed.replace(changed.find("17"), 2, "18");
+    write_text_file(hwdb, changed);
+    std::filesystem::last_write_time(hwdb, mtime);
+  }
+  SECTION("index corrupt") {
+    write_text_file(temp.path() / "hwdb.json.idx", "{");
+  }
+
+  auto const db =
+      er::hwinfo::load_type(hwdb, "board-a", er::hwinfo::builtin_schema);
+  REQUIRE(db.types().size() == 2);
+}
+
+TEST_CASE("load_type reports errors at offsets into the file",
+          "[offset_index]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, indexed_hwdb);
+  auto schema = read_text_file(std::filesystem::path(ER_HWINFO_RESOURCE_DIR) /
+                               "hwdb-schema.json");
+  schema.replace(schema.find("\"maximum\": 255"), 14, "\"maximum\": 10");
+  write_text_file(temp.path() / "schema.json", schema);
+
+  const auto whole = er::hwinfo::try_load_type(hwdb, "board-a",
+                                               temp.path() / "schema.json");
+  REQUIRE_FALSE(whole);
+  REQUIRE(whole.error().code == er::hwinfo::errc::schema_violation);
+
+  er::hwinfo::write_offset_index(hwdb);
+  const auto sliced = er::hwinfo::try_load_type(hwdb, "board-a",
+                                                temp.path() / "schema.json");
+  REQUIRE_FALSE(sliced);
+  REQUIRE(sliced.error().code == er::hwinfo::errc::schema_violation);
+  REQUIRE(sliced.error().offset == whole.error().offset);
+}
+
+TEST_CASE("write_offset_index rejects invalid databases", "[offset_index]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, pin_hwdb(R"({ "description": "x" })"));
+  const auto written = er::hwinfo::try_write_offset_index(hwdb);
+  REQUIRE_FALSE(written);
+  REQUIRE(written.error().code == er::hwinfo::errc::schema_violation);
+  REQUIRE_FALSE(std::filesystem::exists(temp.path() / "hwdb.json.idx"));
+
+  const auto missing =
+      er::hwinfo::try_write_offset_index(temp.path() / "missing.json");
+  REQUIRE_FALSE(missing);
+  REQUIRE(missing.error().code == er::hwinfo::errc::file_open_failed);
+}
+
+// --- Tests for parallel validation ---
+
+namespace {
+
+/// A hwdb of count types, whose type i has pin value values(i)
+template <typename Values>
+std::string many_types_hwdb(int count, Values const &values) {
+  std::string hwdb = "{\n";
+  for (int t = 0; t < count; ++t) {
+    hwdb += fmt::format(R"({}  "board-{}": {{ "1.0.{}": {{ "pins": {{ )"
+                        R"("PIN": {{ "description": "pin", "value": {} }})"
+                        R"( }} }} }})",
+                        t ? ",\n" : "", t, t, values(t));
+  }
+  return hwdb + "\n}";
+}
+
+/// Requires validating hwdb on several threads to report what loading it
+/// does, against both the built-in schema and the schema file
+void require_validation_matches_load(std::filesystem::path const &hwdb) {
+  const auto schema =
+      std::filesystem::path(ER_HWINFO_RESOURCE_DIR) / "hwdb-schema.json";
+  const auto require_same = [](auto const &validated, auto const &loaded) {
+    REQUIRE(validated.has_value() == loaded.has_value());
+    if (!loaded) {
+      REQUIRE(validated.error().code == loaded.error().code);
+      REQUIRE(validated.error().offset == loaded.error().offset);
+      REQUIRE(validated.error().detail == loaded.error().detail);
+    }
+  };
+  for (const unsigned threads : {1U, 4U}) {
+    INFO("threads: " << threads);
+    require_same(er::hwinfo::try_validate_database(
+                     hwdb, er::hwinfo::builtin_schema, threads),
+                 er::hwinfo::try_load_database(hwdb,
+                                               er::hwinfo::builtin_schema));
+    require_same(er::hwinfo::try_validate_database(hwdb, schema, threads),
+                 er::hwinfo::try_load_database(hwdb, schema));
+  }
+}
+
+} // namespace
+
+TEST_CASE("validate_database accepts the shipped databases", "[validate]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  require_validation_matches_load(resources / "hwdb.json");
+  require_validation_matches_load(ER_HWINFO_FRAGMENT_DIR);
+  er::hwinfo::validate_database(resources / "hwdb.json",
+                                er::hwinfo::builtin_schema);
+}
+
+TEST_CASE("validate_database reports the first failing type",
+          "[validate]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+
+  SECTION("valid") {
+    write_text_file(hwdb, many_types_hwdb(100, [](int t) { return t; }));
+  }
+  SECTION("schema violations") {
+    write_text_file(hwdb, many_types_hwdb(100, [](int t) {
+                      return t == 37 || t == 80 ? 300 : t;
+                    }));
+  }
+  SECTION("string too long") {
+    auto text = many_types_hwdb(100, [](int t) { return t; });
+    text.replace(text.find("board-42"), 8, std::string(65, 'b'));
+    write_text_file(hwdb, text);
+  }
+  SECTION("invalid base") {
+    auto text = many_types_hwdb(100, [](int t) { return t; });
+    const auto revision = text.find(R"("1.0.61": {)") + 11;
+    text.insert(revision, R"( "base": "9.9.9",)");
+    write_text_file(hwdb, text);
+  }
+  SECTION("parse error after a schema violation") {
+    auto text = many_types_hwdb(100, [](int t) { return t == 20 ? 300 : t; });
+    text.insert(text.find("board-90") - 1, "]");
+    write_text_file(hwdb, text);
+  }
+  SECTION("repeated type") {
+    auto text = many_types_hwdb(100, [](int t) { return t; });
+    text.replace(text.find("board-50"), 8, "board-10");
+    text.replace(text.find(R"("1.0.50")"), 8, R"("1.x.50")");
+    write_text_file(hwdb, text);
+  }
+  SECTION("missing") {}
+
+  require_validation_matches_load(hwdb);
+}
+
+TEST_CASE("validate_database checks schemas constraining types jointly "
+          "whole",
+          "[validate]") {
+  TempDir temp;
+  const auto resources = std::filesystem::path(ER_HWINFO_RESOURCE_DIR);
+  auto schema = read_text_file(resources / "hwdb-schema.json");
+  schema.insert(schema.find('{') + 1, R"( "required": ["board-0"],)");
+  write_text_file(temp.path() / "schema.json", schema);
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, many_types_hwdb(10, [](int t) { return t; }));
+  REQUIRE(er::hwinfo::try_validate_database(hwdb, temp.path() / "schema.json",
+                                            4));
+
+  auto text = many_types_hwdb(10, [](int t) { return t; });
+  text.replace(text.find("board-0"), 7, "board-x");
+  write_text_file(hwdb, text);
+  const auto validated =
+      er::hwinfo::try_validate_database(hwdb, temp.path() / "schema.json", 4);
+  const auto loaded =
+      er::hwinfo::try_load_database(hwdb, temp.path() / "schema.json");
+  REQUIRE_FALSE(loaded);
+  REQUIRE_FALSE(validated);
+  REQUIRE(validated.error().detail == loaded.error().detail);
+}
+
+// --- Tests for incremental reloads ---
+
+namespace {
+
+/// Pins of the one revision of type t of a many_types_hwdb() database
+std::shared_ptr<const er::hwinfo::pin_map>
+type_pins(er::hwinfo::database const &db, int t) {
+  auto const *type = db.find_type(fmt::format("board-{}", t));
+  REQUIRE(type != nullptr);
+  REQUIRE(type->pins.size() == 1);
+  return type->pins[0];
+}
+
+} // namespace
+
+TEST_CASE("reload_database reuses the types whose text is unchanged",
+          "[reload]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  const auto schema =
+      std::filesystem::path(ER_HWINFO_RESOURCE_DIR) / "hwdb-schema.json";
+  write_text_file(hwdb, many_types_hwdb(5, [](int t) { return t; }));
+
+  // A database without hashes is indexed whole once
+  auto const loaded = er::hwinfo::load_database(hwdb, schema);
+  REQUIRE_FALSE(loaded.hashes());
+  auto const first = er::hwinfo::reload_database(loaded, hwdb, schema);
+  REQUIRE(first.hashes());
+  REQUIRE(type_pins(first, 0) != type_pins(loaded, 0));
+
+  auto const same = er::hwinfo::reload_database(first, hwdb, schema);
+  for (int t = 0; t < 5; ++t) {
+    REQUIRE(type_pins(same, t) == type_pins(first, t));
+  }
+
+  // board-2 changes, board-4 is removed and board-9 added
+  auto text = many_types_hwdb(4, [](int t) { return t == 2 ? 42 : t; });
+  text.insert(text.rfind('}'), R"(, "board-9": { "1.0.0": { "pins": { )"
+                               R"("PIN": { "description": "pin", )"
+                               R"("value": 9 } } } })");
+  write_text_file(hwdb, text);
+  auto const changed = er::hwinfo::reload_database(same, hwdb, schema);
+  REQUIRE(changed.types().size() == 5);
+  REQUIRE(changed.find_type("board-4") == nullptr);
+  REQUIRE(type_pins(changed, 2) != type_pins(same, 2));
+  REQUIRE(type_pins(changed, 2)->number(0) == 42);
+  REQUIRE(type_pins(changed, 9)->number(0) == 9);
+  for (const int t : {0, 1, 3}) {
+    REQUIRE(type_pins(changed, t) == type_pins(same, t));
+  }
+
+  // Switching schemas indexes everything again
+  auto const builtin =
+      er::hwinfo::reload_database(changed, hwdb, er::hwinfo::builtin_schema);
+  REQUIRE(type_pins(builtin, 0) != type_pins(changed, 0));
+  auto const again =
+      er::hwinfo::reload_database(builtin, hwdb, er::hwinfo::builtin_schema);
+  REQUIRE(type_pins(again, 0) == type_pins(builtin, 0));
+}
+
+TEST_CASE("reload_database re-indexes all types when the schema changes",
+          "[reload]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  const auto schema = temp.path() / "schema.json";
+  const auto resources = std::filesystem::path(ER_HWINFO_RESOURCE_DIR);
+  write_text_file(schema, read_text_file(resources / "hwdb-schema.json"));
+  write_text_file(hwdb, many_types_hwdb(3, [](int t) { return t; }));
+
+  auto const first = er::hwinfo::reload_database(
+      er::hwinfo::database({}), hwdb, schema);
+  auto text = read_text_file(schema);
+  text.insert(text.find('{') + 1, R"( "title": "edited",)");
+  write_text_file(schema, text);
+  auto const reloaded = er::hwinfo::reload_database(first, hwdb, schema);
+  for (int t = 0; t < 3; ++t) {
+    REQUIRE(type_pins(reloaded, t) != type_pins(first, t));
+  }
+
+  // Schemas constraining the types jointly load the database whole
+  text.insert(text.find('{') + 1, R"( "required": ["board-0"],)");
+  write_text_file(schema, text);
+  auto const whole = er::hwinfo::reload_database(reloaded, hwdb, schema);
+  REQUIRE_FALSE(whole.hashes());
+  REQUIRE(whole.types().size() == 3);
+}
+
+TEST_CASE("try_reload_database reports the errors of try_load_database",
+          "[reload]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, many_types_hwdb(10, [](int t) { return t; }));
+  auto const previous = er::hwinfo::reload_database(
+      er::hwinfo::database({}), hwdb, er::hwinfo::builtin_schema);
+
+  SECTION("schema violation in a changed type") {
+    write_text_file(hwdb, many_types_hwdb(10, [](int t) {
+                      return t == 7 ? 300 : t;
+                    }));
+  }
+  SECTION("parse error") {
+    auto text = many_types_hwdb(10, [](int t) { return t; });
+    text.insert(text.find("board-5") - 1, "]");
+    write_text_file(hwdb, text);
+  }
+  SECTION("repeated type") {
+    auto text = many_types_hwdb(10, [](int t) { return t; });
+    text.replace(text.find("board-5"), 7, "board-1");
+    write_text_file(hwdb, text);
+  }
+  SECTION("missing") { std::filesystem::remove(hwdb); }
+
+  const auto reloaded = er::hwinfo::try_reload_database(
+      previous, hwdb, er::hwinfo::builtin_schema);
+  const auto loaded =
+      er::hwinfo::try_load_database(hwdb, er::hwinfo::builtin_schema);
+  REQUIRE(reloaded.has_value() == loaded.has_value());
+  if (!loaded) {
+    REQUIRE(reloaded.error().code == loaded.error().code);
+    REQUIRE(reloaded.error().offset == loaded.error().offset);
+    REQUIRE(reloaded.error().detail == loaded.error().detail);
+  } else {
+    REQUIRE(reloaded->types().size() == loaded->types().size());
+  }
+}
+
+TEST_CASE("reload_database re-indexes only changed fragments", "[reload]") {
+  TempDir temp;
+  const auto dir = temp.path() / "hwdb.d";
+  create_fragment_dir(dir);
+  write_text_file(dir / "board-b.json", R"({
+    "board-b": {
+      "1.0.0": { "pins": { "KEY": { "description": "Button", "value": 4 } } }
+    }
+  })");
+  auto const first = er::hwinfo::reload_database(
+      er::hwinfo::database({}), dir, er::hwinfo::builtin_schema);
+
+  write_text_file(dir / "board-b.json", R"({
+    "board-b": {
+      "1.0.0": { "pins": { "KEY": { "description": "Button", "value": 5 } } }
+    }
+  })");
+  auto const reloaded =
+      er::hwinfo::reload_database(first, dir, er::hwinfo::builtin_schema);
+  REQUIRE(reloaded.find_type("board-a")->pins[0] ==
+          first.find_type("board-a")->pins[0]);
+  REQUIRE(reloaded.find_type("board-b")->pins[0]->number(0) == 5);
+}
+
+TEST_CASE("database_handle reloads only the types that changed",
+          "[reload]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  const auto schema =
+      std::filesystem::path(ER_HWINFO_RESOURCE_DIR) / "hwdb-schema.json";
+  write_text_file(hwdb, many_types_hwdb(3, [](int t) { return t; }));
+  er::hwinfo::database_handle handle(er::hwinfo::load_database(hwdb, schema));
+  handle.reload(hwdb, schema);
+  const auto pins = [&](int t) {
+    return handle.with_snapshot(
+        [&](er::hwinfo::database const &db) { return type_pins(db, t); });
+  };
+  const auto before = pins(0);
+
+  write_text_file(hwdb, many_types_hwdb(3, [](int t) { return t * 2; }));
+  handle.reload(hwdb, schema);
+  REQUIRE(pins(0) == before);
+  REQUIRE(pins(1)->number(0) == 2);
+  REQUIRE(pins(2)->number(0) == 4);
+
+  std::filesystem::remove(hwdb);
+  REQUIRE_FALSE(handle.try_reload(hwdb, schema));
+  REQUIRE(pins(0) == before);
+}
+
+// --- Tests for the pin cache of a database ---
+
+namespace {
+
+/// The device of revision 1.0.t of type t of a many_types_hwdb() database
+er::hwinfo::device many_types_device(int t) {
+  return {.hw_type = er::hwinfo::type_name_string(fmt::format("board-{}", t)),
+          .hw_revision = {1, 0, static_cast<std::size_t>(t)}};
+}
+
+} // namespace
+
+TEST_CASE("cached_pins memoises lookup", "[pin_cache]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  auto const db = er::hwinfo::load_database(resources / "hwdb.json",
+                                            er::hwinfo::builtin_schema);
+  const er::hwinfo::device dev{"mrcm", {1, 0, 0}};
+
+  auto const first = db.cached_pins(dev);
+  REQUIRE(first != nullptr);
+  auto const expected = er::hwinfo::lookup(dev, db).pins;
+  REQUIRE(first->size() == expected.size());
+  const auto same_pin = [](auto const &a, auto const &b) {
+    return a.name == b.name && a.number == b.number &&
+           a.description == b.description;
+  };
+  REQUIRE(std::ranges::equal(*first, expected, same_pin));
+  REQUIRE(db.cached_pins(dev) == first);
+  // Revisions selecting the same pins are cached apart
+  REQUIRE(db.cached_pins({"mrcm", {1, 0, 1}}) != first);
+
+  REQUIRE(db.cached_pins({"unknown", {1, 0, 0}}) == nullptr);
+  REQUIRE(db.cached_pins({"unknown", {1, 0, 0}}) == nullptr);
+  auto const stats = db.cache_stats();
+  REQUIRE(stats.hits == 2);
+  REQUIRE(stats.misses == 3);
+  REQUIRE(stats.size == 3);
+
+  // Copies start empty, the pins stay valid after the database is gone
+  std::shared_ptr<const er::hwinfo::pin_set> kept;
+  {
+    auto const copy = db;
+    REQUIRE(copy.cache_stats().size == 0);
+    kept = copy.cached_pins(dev);
+  }
+  REQUIRE(kept->size() == expected.size());
+}
+
+TEST_CASE("cached_pins evicts the devices cached first", "[pin_cache]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  const int count = er::hwinfo::impl::pin_cache::default_capacity + 10;
+  write_text_file(hwdb, many_types_hwdb(count, [](int t) { return t; }));
+  auto const db = er::hwinfo::load_database(hwdb, er::hwinfo::builtin_schema);
+
+  for (int t = 0; t < count; ++t) {
+    REQUIRE(db.cached_pins(many_types_device(t))->begin()->number ==
+            static_cast<std::size_t>(t));
+  }
+  auto stats = db.cache_stats();
+  REQUIRE(stats.size == stats.capacity);
+  REQUIRE(stats.misses == static_cast<std::uint64_t>(count));
+
+  db.cached_pins(many_types_device(count - 1));
+  REQUIRE(db.cache_stats().hits == 1);
+  db.cached_pins(many_types_device(0));
+  REQUIRE(db.cache_stats().misses == static_cast<std::uint64_t>(count) + 1);
+  REQUIRE(db.cache_stats().size == stats.capacity);
+}
+
+TEST_CASE("cached_pins shares one result between threads", "[pin_cache]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json";
+  write_text_file(hwdb, many_types_hwdb(4, [](int t) { return t; }));
+  er::hwinfo::database_handle handle(
+      er::hwinfo::load_database(hwdb, er::hwinfo::builtin_schema));
+
+  constexpr int threads = 8;
+  constexpr int rounds = 1000;
+  std::vector<std::array<er::hwinfo::pin_set const *, 4>> seen(threads);
+  {
+    std::vector<std::jthread> workers;
+    for (int i = 0; i < threads; ++i) {
+      workers.emplace_back([&, i] {
+        for (int round = 0; round < rounds; ++round) {
+          const auto t = round % 4;
+          auto const pins = handle.cached_pins(many_types_device(t));
+          if (round < 4) {
+            seen[i][t] = pins.get();
+          } else if (pins.get() != seen[i][t]) {
+            seen[i][t] = nullptr;
+          }
+        }
+      });
+    }
+  }
+  for (auto const &pins : seen) {
+    REQUIRE(pins == seen[0]);
+    REQUIRE(std::ranges::count(pins, nullptr) == 0);
+  }
+  auto const stats = handle.with_snapshot(
+      [](er::hwinfo::database const &db) { return db.cache_stats(); });
+  REQUIRE(stats.hits + stats.misses == threads * rounds);
+  REQUIRE(stats.size == 4);
+}
+
+// --- Tests for zstd-compressed databases ---
+
+namespace {
+
+/// Writes text to path as a single zstd frame, or with a forged frame header
+/// if zstd is unavailable
+void write_zstd_file(std::filesystem::path const &path,
+                     std::string const &text) {
+#if defined(ER_HWINFO_ZSTD)
+  std::string compressed(ZSTD_compressBound(text.size()), '\0');
+  const auto size = ZSTD_compress(compressed.data(), compressed.size(),
+                                  text.data(), text.size(), 3);
+  REQUIRE_FALSE(ZSTD_isError(size));
+  compressed.resize(size);
+  write_text_file(path, compressed);
+#else
+  write_text_file(path, "\x28\xb5\x2f\xfd" + text);
+#endif
+}
+
+} // namespace
+
+#if defined(ER_HWINFO_ZSTD)
+TEST_CASE("load_database decompresses zstd-compressed databases", "[zstd]") {
+  TempDir temp;
+  const auto resources = std::filesystem::path(ER_HWINFO_RESOURCE_DIR);
+  const auto hwdb = temp.path() / "hwdb.json.zst";
+  write_zstd_file(hwdb, read_text_file(resources / "hwdb.json"));
+
+  auto const plain = er::hwinfo::load_database(resources / "hwdb.json",
+                                               er::hwinfo::builtin_schema);
+  auto const builtin =
+      er::hwinfo::load_database(hwdb, er::hwinfo::builtin_schema);
+  auto const schema =
+      er::hwinfo::load_database(hwdb, resources / "hwdb-schema.json");
+  REQUIRE(builtin.types().size() == plain.types().size());
+  REQUIRE(schema.types().size() == plain.types().size());
+  for (auto const &[name, revisions] : plain.types()) {
+    INFO(name);
+    for (auto const *db : {&builtin, &schema}) {
+      auto const *found = db->find_type(name);
+      REQUIRE(found != nullptr);
+      REQUIRE(found->keys == revisions.keys);
+      for (std::size_t i = 0; i < revisions.size(); ++i) {
+        REQUIRE(*found->pins[i] == *revisions.pins[i]);
+      }
+    }
+  }
+}
+
+TEST_CASE("load_database reports errors inside compressed databases",
+          "[zstd]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json.zst";
+  const auto text = pin_hwdb(R"({ "description": "x" })");
+  write_zstd_file(hwdb, text);
+
+  const auto invalid =
+      er::hwinfo::try_load_database(hwdb, er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(invalid);
+  REQUIRE(invalid.error().code == er::hwinfo::errc::schema_violation);
+  // Offsets count decompressed characters
+  REQUIRE(invalid.error().offset > text.find("description"));
+  REQUIRE(invalid.error().offset <= text.size());
+}
+
+TEST_CASE("load_database rejects corrupt compressed databases", "[zstd]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json.zst";
+  write_zstd_file(hwdb, read_text_file(std::filesystem::path(
+                            ER_HWINFO_RESOURCE_DIR) /
+                        "hwdb.json"));
+  auto compressed = read_text_file(hwdb);
+
+  SECTION("truncated") { compressed.resize(compressed.size() / 2); }
+  SECTION("garbage after the header") {
+    compressed.replace(8, compressed.size() - 8, compressed.size() - 8, 'x');
+  }
+  write_text_file(hwdb, compressed);
+
+  const auto loaded =
+      er::hwinfo::try_load_database(hwdb, er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(loaded);
+  REQUIRE(loaded.error().code == er::hwinfo::errc::decompression_failed);
+  REQUIRE(loaded.error().detail.starts_with(hwdb.string()));
+}
+#else
+TEST_CASE("load_database rejects compressed databases without zstd support",
+          "[zstd]") {
+  TempDir temp;
+  const auto hwdb = temp.path() / "hwdb.json.zst";
+  write_zstd_file(hwdb, pin_hwdb(R"({ "description": "x", "value": 1 })"));
+
+  const auto loaded =
+      er::hwinfo::try_load_database(hwdb, er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(loaded);
+  REQUIRE(loaded.error().code == er::hwinfo::errc::unsupported_compression);
+  REQUIRE(loaded.error().detail == hwdb.string());
+}
+#endif
+
+// --- Tests for overlapped loading ---
+
+namespace {
+
+/// Pins of info as NAME=GPIO pairs, for comparing the results of get()
+std::vector<std::string> pin_numbers(er::hwinfo::info const &info) {
+  std::vector<std::string> pins;
+  for (auto const &pin : info.pins) {
+    pins.push_back(fmt::format("{}={}", pin.name, pin.number));
+  }
+  return pins;
+}
+
+} // namespace
+
+TEST_CASE("read_files reads every file or records why it could not",
+          "[overlapped]") {
+  TempDir temp;
+  write_text_file(temp.path() / "a.txt", "alpha");
+  write_text_file(temp.path() / "empty.txt", "");
+  const std::string large(200000, 'x');
+  write_text_file(temp.path() / "large.txt", large);
+
+  std::vector<er::hwinfo::impl::file_read> files{
+      er::hwinfo::impl::file_read(temp.path() / "a.txt"),
+      er::hwinfo::impl::file_read(temp.path() / "missing.txt"),
+      er::hwinfo::impl::file_read(temp.path() / "empty.txt"),
+      er::hwinfo::impl::file_read(temp.path() / "large.txt"),
+  };
+  SECTION("io_uring or threads") { er::hwinfo::impl::read_files(files); }
+  SECTION("threads") { er::hwinfo::impl::read_files_threaded(files); }
+
+  REQUIRE(files[0].status);
+  REQUIRE(files[0].text == "alpha");
+  REQUIRE_FALSE(files[1].status);
+  REQUIRE(files[1].status.error().code == er::hwinfo::errc::file_open_failed);
+  REQUIRE(files[2].status);
+  REQUIRE(files[2].text.empty());
+  REQUIRE(files[3].status);
+  REQUIRE(files[3].text == large);
+}
+
+TEST_CASE("get_overlapped matches get", "[overlapped]") {
+  TempDir temp;
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  const auto schema = resources / "hwdb-schema.json";
+  const auto hwdb = temp.path() / "hwdb.json";
+  std::filesystem::copy_file(resources / "hwdb.json", hwdb);
+  const auto [major, minor, patch] =
+      GENERATE(std::array<std::uint32_t, 3>{0, 5, 0},
+               std::array<std::uint32_t, 3>{1, 0, 0},
+               std::array<std::uint32_t, 3>{1, 7, 2},
+               std::array<std::uint32_t, 3>{2, 0, 0});
+  // NUL-terminated, as device tree string properties are
+  create_device_tree(temp.path() / "dt", std::string("mrcm\0", 5), major,
+                     minor, patch);
+
+  std::filesystem::path db = hwdb;
+  SECTION("hwdb.json") {}
+  SECTION("hwdb.json with offset index") {
+    er::hwinfo::write_offset_index(hwdb);
+  }
+  SECTION("hwdb.json with stale offset index") {
+    er::hwinfo::write_offset_index(hwdb);
+    std::filesystem::last_write_time(
+        hwdb, std::filesystem::last_write_time(hwdb) + std::chrono::seconds(1));
+  }
+  SECTION("hwdb.d") { db = ER_HWINFO_FRAGMENT_DIR; }
+
+  auto const expected = er::hwinfo::get(temp.path() / "dt", db, schema);
+  auto const overlapped =
+      er::hwinfo::get_overlapped(temp.path() / "dt", db, schema);
+  REQUIRE(expected.has_value());
+  REQUIRE(overlapped.has_value());
+  REQUIRE(overlapped->dev.hw_type == "mrcm");
+  REQUIRE(overlapped->dev.hw_type == expected->dev.hw_type);
+  REQUIRE(overlapped->dev.hw_revision.as_string() ==
+          expected->dev.hw_revision.as_string());
+  REQUIRE(pin_numbers(*overlapped) == pin_numbers(*expected));
+  REQUIRE(overlapped->pins.empty() == (major == 2));
+}
+
+TEST_CASE("try_get_overlapped reports the errors of try_get",
+          "[overlapped]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  write_text_file(temp.path() / "invalid.json", "{ \"test-board\": [");
+
+  REQUIRE_FALSE(er::hwinfo::get_overlapped(temp.path() / "nonexistent",
+                                           temp.path() / "hwdb.json",
+                                           temp.path() / "schema.json"));
+  const auto check = [&](std::filesystem::path const &hwdb,
+                         std::filesystem::path const &schema) {
+    const auto expected = er::hwinfo::try_get(temp.path(), hwdb, schema);
+    const auto overlapped =
+        er::hwinfo::try_get_overlapped(temp.path(), hwdb, schema);
+    REQUIRE_FALSE(expected);
+    REQUIRE_FALSE(overlapped);
+    REQUIRE(overlapped.error().message() == expected.error().message());
+  };
+  check(temp.path() / "missing.json", temp.path() / "schema.json");
+  check(temp.path() / "hwdb.json", temp.path() / "missing.json");
+  check(temp.path() / "invalid.json", temp.path() / "schema.json");
+  check(temp.path() / "hwdb.json", temp.path() / "invalid.json");
+}
+
+// --- Tests for prefetch ---
+
+namespace {
+
+/// Waits for the prefetch() in flight, if any, to complete
+void wait_for_prefetch() {
+  auto &state = er::hwinfo::impl::prefetched();
+  const std::lock_guard lock(state.mutex);
+  if (state.pending.valid()) {
+    state.pending.wait();
+  }
+}
+
+} // namespace
+
+TEST_CASE("get takes the result of prefetch once", "[prefetch]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  er::hwinfo::prefetch(temp.path(), temp.path() / "hwdb.json",
+                       temp.path() / "schema.json");
+  wait_for_prefetch();
+  // Later loads must fail, so success shows the prefetched result was used
+  std::filesystem::remove(temp.path() / "hwdb.json");
+
+  auto const prefetched = er::hwinfo::try_get(
+      temp.path(), temp.path() / "hwdb.json", temp.path() / "schema.json");
+  REQUIRE(prefetched);
+  REQUIRE(pin_numbers(*prefetched) == std::vector<std::string>{"LED=17"});
+
+  auto const reloaded = er::hwinfo::try_get(
+      temp.path(), temp.path() / "hwdb.json", temp.path() / "schema.json");
+  REQUIRE_FALSE(reloaded);
+  REQUIRE(reloaded.error().code == er::hwinfo::errc::file_open_failed);
+}
+
+TEST_CASE("get discards a prefetch of other paths", "[prefetch]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  write_text_file(temp.path() / "other.json", R"({ "test-board": {} })");
+
+  er::hwinfo::prefetch(temp.path(), temp.path() / "hwdb.json",
+                       temp.path() / "schema.json");
+  wait_for_prefetch();
+  auto const other = er::hwinfo::get(temp.path(), temp.path() / "other.json",
+                                     temp.path() / "schema.json");
+  REQUIRE(other.has_value());
+  REQUIRE(other->pins.empty());
+  REQUIRE_FALSE(er::hwinfo::impl::prefetched().has_pending.load());
+
+  // Nothing is left for the prefetched paths: a later get() loads again
+  std::filesystem::remove(temp.path() / "hwdb.json");
+  auto const reloaded = er::hwinfo::try_get(
+      temp.path(), temp.path() / "hwdb.json", temp.path() / "schema.json");
+  REQUIRE_FALSE(reloaded);
+  REQUIRE(reloaded.error().code == er::hwinfo::errc::file_open_failed);
+}
+
+TEST_CASE("prefetch replaces an untaken prefetch without waiting",
+          "[prefetch]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  // Never taken, so only its detached thread may still be running
+  er::hwinfo::prefetch(temp.path() / "a", temp.path() / "hwdb.json",
+                       temp.path() / "schema.json");
+  er::hwinfo::prefetch(temp.path(), temp.path() / "hwdb.json",
+                       temp.path() / "schema.json");
+  auto const prefetched = er::hwinfo::try_get(
+      temp.path(), temp.path() / "hwdb.json", temp.path() / "schema.json");
+  REQUIRE(prefetched);
+  REQUIRE(pin_numbers(*prefetched) == std::vector<std::string>{"LED=17"});
+}
+
+TEST_CASE("prefetch passes on missing devices and errors", "[prefetch]") {
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  er::hwinfo::prefetch(temp.path() / "nonexistent", temp.path() / "hwdb.json",
+                       temp.path() / "schema.json");
+  REQUIRE_FALSE(er::hwinfo::get(temp.path() / "nonexistent",
+                                temp.path() / "hwdb.json",
+                                temp.path() / "schema.json"));
+
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  er::hwinfo::prefetch(temp.path(), temp.path() / "missing.json",
+                       temp.path() / "schema.json");
+  auto const missing = er::hwinfo::try_get(
+      temp.path(), temp.path() / "missing.json", temp.path() / "schema.json");
+  REQUIRE_FALSE(missing);
+  REQUIRE(missing.error().code == er::hwinfo::errc::file_open_failed);
+}
+
+// --- Tests for the coroutine API ---
+
+namespace {
+
+/// Coroutine that starts eagerly and signals done when it returns
+struct test_task {
+  struct promise_type {
+    std::promise<void> done;
+
+    test_task get_return_object() { return {done.get_future()}; }
+    std::suspend_never initial_suspend() noexcept { return {}; }
+    std::suspend_never final_suspend() noexcept { return {}; }
+    void return_void() { done.set_value(); }
+    void unhandled_exception() {
+      done.set_exception(std::current_exception());
+    }
+  };
+
+  std::future<void> done;
+};
+
+/// Executor running each task on a new thread, recording the thread ids
+struct thread_executor {
+  std::vector<std::jthread> *threads;
+
+  void operator()(std::function<void()> task) const {
+    threads->emplace_back(std::move(task));
+  }
+};
+
+} // namespace
+
+TEST_CASE("async_get resumes on the executor with the result of get",
+          "[async]") {
+  TempDir temp;
+  create_device_tree(temp.path(), "test-board", 1, 2, 3);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+
+  std::vector<std::jthread> threads;
+  std::thread::id resumed_on;
+  std::optional<er::hwinfo::info> found;
+  auto const query = [&]() -> test_task {
+    found = co_await er::hwinfo::async_get(
+        thread_executor{&threads}, temp.path(), temp.path() / "hwdb.json",
+        temp.path() / "schema.json");
+    resumed_on = std::this_thread::get_id();
+  };
+  query().done.get();
+
+  REQUIRE(threads.size() == 1);
+  REQUIRE(resumed_on == threads.front().get_id());
+  REQUIRE(found.has_value());
+  REQUIRE(pin_numbers(*found) == std::vector<std::string>{"LED=17"});
+}
+
+TEST_CASE("async_load_database yields the database", "[async]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  // Runs the task inline, resuming within await_suspend
+  const auto inline_executor = [](std::function<void()> task) { task(); };
+  auto const expected = er::hwinfo::load_database(resources / "hwdb.json",
+                                                  er::hwinfo::builtin_schema);
+
+  std::size_t builtin_types = 0;
+  std::size_t schema_types = 0;
+  auto const load = [&]() -> test_task {
+    auto const builtin = co_await er::hwinfo::async_load_database(
+        inline_executor, resources / "hwdb.json", er::hwinfo::builtin_schema);
+    builtin_types = builtin.types().size();
+    auto const schema = co_await er::hwinfo::async_try_load_database(
+        inline_executor, resources / "hwdb.json",
+        resources / "hwdb-schema.json");
+    schema_types = schema ? schema->types().size() : 0;
+  };
+  load().done.get();
+
+  REQUIRE(builtin_types == expected.types().size());
+  REQUIRE(schema_types == expected.types().size());
+}
+
+TEST_CASE("async API reports errors in the awaiting coroutine", "[async]") {
+  TempDir temp;
+  std::vector<std::jthread> threads;
+  // Catch2 assertions are not thread-safe, so results are checked here
+  std::optional<er::hwinfo::errc> load_error;
+  std::optional<er::hwinfo::errc> get_error;
+  bool found = true;
+  auto const load = [&]() -> test_task {
+    auto const db = co_await er::hwinfo::async_try_load_database(
+        thread_executor{&threads}, temp.path() / "missing.json",
+        er::hwinfo::builtin_schema);
+    load_error = db ? std::nullopt : std::optional(db.error().code);
+    auto const info = co_await er::hwinfo::async_try_get(
+        thread_executor{&threads}, temp.path() / "nonexistent");
+    get_error = info ? std::nullopt : std::optional(info.error().code);
+    found = (co_await er::hwinfo::async_get(thread_executor{&threads},
+                                            temp.path() / "nonexistent"))
+                .has_value();
+  };
+  load().done.get();
+  REQUIRE(load_error == er::hwinfo::errc::file_open_failed);
+  REQUIRE(get_error == er::hwinfo::errc::no_device);
+  REQUIRE_FALSE(found);
+
+#if defined(__cpp_exceptions)
+  auto const throwing = [&]() -> test_task {
+    co_await er::hwinfo::async_load_database(thread_executor{&threads},
+                                             temp.path() / "missing.json",
+                                             er::hwinfo::builtin_schema);
+  };
+  REQUIRE_THROWS_AS(throwing().done.get(), std::runtime_error);
+#endif
+}
+
+TEST_CASE("async API lets executors complete the task before returning",
+          "[async]") {
+  const std::filesystem::path resources = ER_HWINFO_RESOURCE_DIR;
+  // Runs the task inline or on a thread it joins, then uses its own state
+  struct completing_executor {
+    bool on_thread;
+    std::shared_ptr<std::vector<int>> log =
+        std::make_shared<std::vector<int>>();
+    std::vector<int> *seen;
+
+    void operator()(std::function<void()> task) const {
+      log->push_back(1);
+      if (on_thread) {
+        std::jthread(std::move(task)).join();
+      } else {
+        task();
+      }
+      log->push_back(2);
+      *seen = *log;
+    }
+  };
+
+  for (const bool on_thread : {false, true}) {
+    INFO("on_thread: " << on_thread);
+    std::vector<int> seen;
+    std::thread::id resumed_on;
+    std::size_t types = 0;
+    const completing_executor executor{.on_thread = on_thread,
+                                       .seen = &seen};
+    auto const load = [&]() -> test_task {
+      auto const db = co_await er::hwinfo::async_load_database(
+          executor, resources / "hwdb.json", er::hwinfo::builtin_schema);
+      // The executor has returned before the coroutine continues
+      types = seen.size() == 2 ? db.types().size() : 0;
+      resumed_on = std::this_thread::get_id();
+    };
+    load().done.get();
+    REQUIRE(types > 0);
+    REQUIRE(resumed_on == std::this_thread::get_id());
+  }
+}
+
+// --- Tests for er::hwinfo::fixed_string ---
+
+TEST_CASE("fixed_string stores text inline", "[fixed_string]") {
+  using text = er::hwinfo::fixed_string<8>;
+  static_assert(std::is_trivially_copyable_v<text>);
+
+  text s = "LED";
+  REQUIRE(s.size() == 3);
+  REQUIRE(s == "LED");
+  REQUIRE(std::string_view(s.c_str()) == "LED");
+  REQUIRE(s < text("MOTOR"));
+  REQUIRE(fmt::format("{:>5}", s) == "  LED");
+
+  REQUIRE(s.assign("12345678"));
+  REQUIRE(s == "12345678");
+  REQUIRE_FALSE(s.assign("123456789"));
+  REQUIRE(s == "12345678");
+  REQUIRE(text(std::string_view("123456789")) == "12345678");
+}
+
+#if defined(ER_HWINFO_INLINE_STRINGS)
+TEST_CASE("inline strings make pins and devices trivially copyable",
+          "[fixed_string]") {
+  static_assert(std::is_trivially_copyable_v<er::hwinfo::pin>);
+  static_assert(std::is_trivially_copyable_v<er::hwinfo::device>);
+  TempDir temp;
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", valid_hwdb);
+  auto const db = er::hwinfo::load_database(temp.path() / "hwdb.json",
+                                            temp.path() / "schema.json");
+  const er::hwinfo::device dev{"test-board", {1, 2, 3}};
+  auto const pins = er::hwinfo::lookup(dev, db).pins;
+  REQUIRE(pins.size() == 1);
+
+  // as if through a shared memory segment
+  std::vector<std::byte> shm(sizeof(er::hwinfo::pin) + sizeof(dev));
+  std::memcpy(shm.data(), &*pins.begin(), sizeof(er::hwinfo::pin));
+  std::memcpy(shm.data() + sizeof(er::hwinfo::pin), &dev, sizeof(dev));
+  er::hwinfo::pin pin_copy;
+  er::hwinfo::device dev_copy;
+  std::memcpy(&pin_copy, shm.data(), sizeof(pin_copy));
+  std::memcpy(&dev_copy, shm.data() + sizeof(pin_copy), sizeof(dev_copy));
+
+  REQUIRE(pin_copy.name == "LED");
+  REQUIRE(pin_copy.number == 17);
+  REQUIRE(pin_copy.description == "Status LED");
+  REQUIRE(dev_copy.hw_type == "test-board");
+  REQUIRE(dev_copy.hw_revision == dev.hw_revision);
+}
+
+TEST_CASE("load_database rejects strings exceeding inline storage",
+          "[fixed_string]") {
+  // within the schema's 256 code points, but not 256 bytes
+  std::string description;
+  for (int i = 0; i < 200; ++i) {
+    description += "\xc3\xa9";
+  }
+  TempDir temp;
+  write_text_file(temp.path() / "hwdb.json",
+                  pin_hwdb(fmt::format(R"({{ "description": "{}", )"
+                                       R"("value": 1 }})",
+                                       description)));
+
+  const auto db = er::hwinfo::try_load_database(temp.path() / "hwdb.json",
+                                                er::hwinfo::builtin_schema);
+  REQUIRE_FALSE(db);
+  REQUIRE(db.error().code == er::hwinfo::errc::string_too_long);
+}
+#endif
+
+// --- Tests for er::hwinfo::pin_set transparent lookup ---
+
+TEST_CASE("pin_set supports transparent lookup by name", "[pin_set]") {
+  er::hwinfo::pin_set pins;
+  pins.insert({.name = "LED", .number = 17, .description = "Status LED"});
+  pins.insert({.name = "BUTTON", .number = 27, .description = "User button"});
+  pins.insert({.name = "RELAY", .number = 22, .description = "Power relay"});
+
+  SECTION("find by string_view returns correct pin") {
+    auto it = pins.find(std::string_view("BUTTON"));
+    REQUIRE(it != pins.end());
+    REQUIRE(it->name == "BUTTON");
+    REQUIRE(it->number == 27);
+  }
+
+  SECTION("find by string returns correct pin") {
+    std::string name = "RELAY";
+    auto it = pins.find(name);
+    REQUIRE(it != pins.end());
+    REQUIRE(it->name == "RELAY");
+    REQUIRE(it->number == 22);
+  }
+
+  SECTION("find by string literal returns correct pin") {
+    auto it = pins.find("LED");
+    REQUIRE(it != pins.end());
+    REQUIRE(it->name == "LED");
+    REQUIRE(it->number == 17);
+  }
+
+  SECTION("find returns end for non-existent name") {
+    auto it = pins.find("NONEXISTENT");
+    REQUIRE(it == pins.end());
+  }
+
+  SECTION("contains by name works correctly") {
+    REQUIRE(pins.contains("LED"));
+    REQUIRE(pins.contains("BUTTON"));
+    REQUIRE_FALSE(pins.contains("MISSING"));
+  }
+}
+
+// --- Integration tests for er-hwinfo CLI ---
+
+namespace {
+struct cli_result {
   std::string output;
   int exit_code;
 };
@@ -808,7 +3028,7 @@ cli_result run_cli(const std::string &args) {
   std::string result;
   FILE *pipe = popen(cmd.c_str(), "r");
   if (!pipe) {
-    throw std::runtime_error("popen() failed");
+    return {"popen() failed", -1};
   }
   while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
     result += buffer.data();
@@ -863,6 +3083,103 @@ TEST_CASE("CLI prints no pin info message when hwdb missing", "[cli]") {
   REQUIRE(exit_code == 0);
 }
 
+TEST_CASE("CLI reports timing of each phase", "[cli]") {
+  TempDir temp;
+  create_device_tree(temp.path(), std::string("test-board\0", 11), 1, 0, 0);
+
+  auto [output, exit_code] = run_cli("--timing " + temp.path().string());
+
+  REQUIRE(output.find("Device type: test-board\n") != std::string::npos);
+  REQUIRE(output.find("read_device: ") != std::string::npos);
+  REQUIRE(exit_code == 0);
+}
+
+TEST_CASE("CLI reads the device's fragment of a hwdb.d directory", "[cli]") {
+  TempDir temp;
+  create_fragment_dir(temp.path() / "hwdb.d");
+  create_device_tree(temp.path() / "dt", "board-a", 1, 0, 0);
+
+  auto [output, exit_code] =
+      run_cli(fmt::format("--hwdb {} {}", (temp.path() / "hwdb.d").string(),
+                          (temp.path() / "dt").string()));
+
+  REQUIRE(output.find("Status") != std::string::npos);
+  REQUIRE(exit_code == 0);
+}
+
+TEST_CASE("CLI batch mode resolves device trees and manifest entries",
+          "[cli][batch]") {
+  TempDir temp;
+  create_device_tree(temp.path() / "board1", std::string("test-board\0", 11),
+                     1, 0, 0);
+  create_device_tree(temp.path() / "board2", "unknown-board", 1, 0, 0);
+  write_text_file(temp.path() / "schema.json", valid_schema);
+  write_text_file(temp.path() / "hwdb.json", R"({
+    "test-board": {
+      "1.0.0": {
+        "pins": {
+          "LED": { "description": "Status LED", "value": 17 },
+          "BUTTON": { "description": "User button", "value": 27 }
+        }
+      }
+    }
+  })");
+  write_text_file(temp.path() / "manifest.txt", "# captured boards\n"
+                                                "test-board 1.0.0\n"
+                                                "\n"
+                                                "test-board 2.0.0\n");
+  const auto db_args =
+      fmt::format("--hwdb {} --schema {} ", (temp.path() / "hwdb.json").string(),
+                  (temp.path() / "schema.json").string());
+
+  for (const auto *jobs : {"1", "4"}) {
+    auto [output, exit_code] = run_cli(fmt::format(
+        "{}--jobs {} --manifest {} {} {} {}", db_args, jobs,
+        (temp.path() / "manifest.txt").string(),
+        (temp.path() / "board1").string(), (temp.path() / "board2").string(),
+        (temp.path() / "missing").string()));
+
+    const auto manifest = (temp.path() / "manifest.txt").string();
+    REQUIRE(output == fmt::format(
+                          "{0}:2\ttest-board\t1.0.0\tBUTTON=27,LED=17\n"
+                          "{0}:4\ttest-board\t2.0.0\t-\n"
+                          "{1}\ttest-board\t1.0.0\tBUTTON=27,LED=17\n"
+                          "{2}\tunknown-board\t1.0.0\t-\n"
+                          "{3}\t-\t-\t-\n",
+                          manifest, (temp.path() / "board1").string(),
+                          (temp.path() / "board2").string(),
+                          (temp.path() / "missing").string()));
+    REQUIRE(exit_code == 0);
+  }
+}
+
+TEST_CASE("CLI batch mode reports malformed manifest lines", "[cli][batch]") {
+  TempDir temp;
+  write_text_file(temp.path() / "manifest.txt", "test-board 1.0\n");
+
+  auto [output, exit_code] = run_cli(
+      "--manifest " + (temp.path() / "manifest.txt").string());
+
+  REQUIRE(output.find("manifest.txt:1: ") != std::string::npos);
+  REQUIRE(exit_code == 1);
+}
+
+TEST_CASE("CLI batch mode fails if the database cannot be loaded",
+          "[cli][batch]") {
+  TempDir temp;
+  create_device_tree(temp.path() / "board1", "test-board", 1, 0, 0);
+  create_device_tree(temp.path() / "board2", "test-board", 2, 0, 0);
+  write_text_file(temp.path() / "hwdb.json", "{ not json");
+
+  auto [output, exit_code] = run_cli(fmt::format(
+      "--hwdb {} {} {}", (temp.path() / "hwdb.json").string(),
+      (temp.path() / "board1").string(), (temp.path() / "board2").string()));
+
+  REQUIRE(output.find("Hardware database unavailable") != std::string::npos);
+  REQUIRE(output.find("\ttest-board\t1.0.0\t-\n") != std::string::npos);
+  REQUIRE(exit_code == 1);
+}
+
 TEST_CASE("CLI prints pin table with correct header", "[cli][table]") {
   TempDir temp;
   create_device_tree(temp.path(), "test-board", 1, 0, 0);